@@ -246,9 +246,10 @@ void ntc_window::event(int evNo, float x, float y)
         }
         msg.packets.push_back(stmevent);
         bit_manipulator w;
+        w.logging = true;
         msg.write_to(w);
         std::string str;
-        for (auto &var : w.log_entries)
+        for (auto &var : w.get_log())
         {
             str += var.first + '\t' + var.second + '\n';
         }
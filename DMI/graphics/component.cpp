@@ -39,6 +39,7 @@ void Component::clear()
         delete graphics[i];
     }
     graphics.clear();
+    invalidate();
 }
 void Component::setPressedAction(function<void()> action)
 {
@@ -59,6 +60,17 @@ void Component::setPressed()
 void Component::setDisplayFunction(function<void()> display)
 {
     this->display = display;
+    invalidate();
+}
+void Component::setLayerDisplay(function<void()> display)
+{
+    layerDisplay = display;
+    invalidate();
+}
+void Component::invalidate()
+{
+    layer_valid = false;
+    layer_stable = false;
 }
 void Component::setSize(float sx, float sy)
 {
@@ -88,15 +100,22 @@ void Component::paint()
         bool counter = (flash_style & 2)>>1;
         show = (fast ? (flash_state&1) : ((flash_state>>1)&1)) == (counter ? 0 : 1);
     }
+    // Plain borders are part of the layer when nothing is displayed over them
+    bool border = dispBorder && display == nullptr;
     if (show || !(flash_style & 4))
     {
-        if(bgColor != DarkBlue) drawRectangle(0, 0, sx, sy, bgColor);
-        for(int i=0; i<graphics.size(); i++)
+        bool layered = retained && (display == nullptr || layerDisplay != nullptr);
+        if (!layered || !paintLayer(border))
         {
-            draw(graphics[i]);
+            paintContent(false);
+            border = false;
         }
         if(display != nullptr) display();
     }
+    else
+    {
+        border = false;
+    }
     if ((show && flash_style != 0 && !(flash_style & 4)) || (ack && (flash_state & 2)))
     {
         drawRectangle(0, 0, 2, sy, Yellow);
@@ -104,7 +123,23 @@ void Component::paint()
         drawRectangle(0, 0, sx, 2, Yellow);
         drawRectangle(0, sy - 2, sx, 2, Yellow);
     }
-    else if(dispBorder)
+    else if(dispBorder && !border)
+    {
+        drawRectangle(0, 0, 1, sy - 1, Black);
+        drawRectangle(sx - 1, 0, 1, sy - 1, Shadow);
+        drawRectangle(0, 0, sx - 1, 1, Black);
+        drawRectangle(0, sy - 1, sx - 1, 1, Shadow);
+    }
+}
+void Component::paintContent(bool border)
+{
+    if(bgColor != DarkBlue) drawRectangle(0, 0, sx, sy, bgColor);
+    for(int i=0; i<graphics.size(); i++)
+    {
+        draw(graphics[i]);
+    }
+    if(layerDisplay != nullptr) layerDisplay();
+    if (border)
     {
         drawRectangle(0, 0, 1, sy - 1, Black);
         drawRectangle(sx - 1, 0, 1, sy - 1, Shadow);
@@ -112,6 +147,43 @@ void Component::paint()
         drawRectangle(0, sy - 1, sx - 1, 1, Shadow);
     }
 }
+bool Component::paintLayer(bool border)
+{
+    if (layer_x != x || layer_y != y || layer_sx != sx || layer_sy != sy || layer_bg != bgColor || layer_border != border)
+    {
+        invalidate();
+        layer_x = x;
+        layer_y = y;
+        layer_sx = sx;
+        layer_sy = sy;
+        layer_bg = bgColor;
+        layer_border = border;
+    }
+    if (!layer_valid)
+    {
+        // Content that changes on every paint is not worth a layer
+        if (!layer_stable)
+        {
+            layer_stable = true;
+            return false;
+        }
+        bool size_changed = layer == nullptr || layer->size().first < sx || layer->size().second < sy;
+        if (size_changed || !platform->begin_layer(*layer, x, y))
+        {
+            layer = platform->create_layer(sx, sy);
+            if (layer == nullptr || !platform->begin_layer(*layer, x, y))
+            {
+                layer = nullptr;
+                return false;
+            }
+        }
+        paintContent(border);
+        platform->end_layer();
+        layer_valid = true;
+    }
+    platform->draw_image(*layer, x, y);
+    return true;
+}
 void Component::drawSolidArc(float ang0, float ang1, float rmin, float rmax, float cx, float cy)
 {
     platform->draw_arc_filled(getX(cx), getY(cy), rmin, rmax, ang0, ang1);
@@ -150,6 +222,10 @@ void Component::draw(graphic *graph)
             circle *c = (circle*)graph;
             drawCircle(c->radius, c->cx, c->cy);
             break;}
+        case TEXT:{
+            text_graphic *t = (text_graphic*)graph;
+            platform->draw_text(t->text, *t->font, getX(t->x - t->width / 2), getY(t->y - t->height / 2), t->color);
+            break;}
         default:
             break;
     }
@@ -208,9 +284,25 @@ std::unique_ptr<text_graphic> Component::getTextUnique(const string &text, float
     t->alignment = align;
     t->aspect = aspect;
     int v = text.find('\n');
-    t->tex = getTextGraphic(text, size, col, aspect, align&(LEFT|RIGHT), width);
-    float sx = t->tex == nullptr ? 0 : t->tex->size().first;
-    float sy = t->tex == nullptr ? 0 : t->tex->size().second;
+    float sx = 0;
+    float sy = 0;
+    if (glyphText && v == -1 && width == 0 && !text.empty() && platform->has_glyph_atlas())
+    {
+        t->font = platform->load_font(size, (aspect & 1) != 0, get_language());
+        if (t->font != nullptr)
+        {
+            t->type = TEXT;
+            std::pair<float, float> wh = t->font->calc_size(text);
+            sx = wh.first;
+            sy = wh.second;
+        }
+    }
+    if (t->font == nullptr)
+    {
+        t->tex = getTextGraphic(text, size, col, aspect, align&(LEFT|RIGHT), width);
+        sx = t->tex == nullptr ? 0 : t->tex->size().first;
+        sy = t->tex == nullptr ? 0 : t->tex->size().second;
+    }
     if (align & UP) y = y + sy / 2;
     else if (align & DOWN) y = (this->sy - y) - sy / 2;
     else y = y + this->sy / 2;
@@ -225,8 +317,7 @@ std::unique_ptr<text_graphic> Component::getTextUnique(const string &text, float
 }
 std::shared_ptr<UiPlatform::Image> Component::getTextGraphic(string text, float size, Color col, int aspect, int align, float width)
 {
-    auto font = platform->load_font(size, (aspect & 1) != 0, get_language());
-    return platform->make_wrapped_text_image(text, *font, width, align, col);
+    return platform->get_text_image(text, size, (aspect & 1) != 0, get_language(), width, align, col);
 }
 void Component::addImage(string path, float cx, float cy, float sx, float sy)
 {
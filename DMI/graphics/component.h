@@ -78,7 +78,7 @@ class Component
         void drawRectangle(float x, float y, float w, float h, Color c, int align = LEFT | UP);
         void addRectangle(float x, float y, float w, float h, Color c, int align = LEFT | UP);
         void drawTexture(std::shared_ptr<UiPlatform::Image> tex, float cx, float cy);
-        void add(graphic* g) { graphics.push_back(g); }
+        void add(graphic* g) { graphics.push_back(g); invalidate(); }
         void addText(std::string text, float x=0, float y=0, float size=12, Color col=White, int align=CENTER, int aspect=0, float width=0);
         text_graphic *getText(const std::string &text, float x=0, float y=0, float size=12, Color col=White, int align=CENTER, int aspect=0, float width=0);
         std::unique_ptr<text_graphic> getTextUnique(const std::string &text, float x = 0, float y = 0, float size = 12, Color col = White, int align = CENTER, int aspect = 0, float width = 0);
@@ -95,6 +95,31 @@ class Component
         void setText(std::string text, float size, Color c);
         void addBorder(Color c);
         void setBorder(Color c);
+        // Retained layer: the background, the graphics, layerDisplay and, if nothing
+        // is displayed over them, the borders are rendered once into an offscreen
+        // image, which is reused until invalidate() is called or any of them changes.
+        // Only worth it for large static content, so components opt in.
+        // Components with a display function only use it if they set layerDisplay.
+        bool retained = false;
+        // Single line texts are drawn from the platform glyph atlas, which
+        // avoids rendering a new image each time they change
+        bool glyphText = false;
+        void setLayerDisplay(std::function<void()> display);
+        void invalidate();
+    private:
+        std::function<void()> layerDisplay = nullptr;
+        std::shared_ptr<UiPlatform::Image> layer;
+        bool layer_valid = false;
+        // The content did not change since the previous paint
+        bool layer_stable = false;
+        float layer_x = 0;
+        float layer_y = 0;
+        float layer_sx = 0;
+        float layer_sy = 0;
+        Color layer_bg = DarkBlue;
+        bool layer_border = false;
+        void paintContent(bool border);
+        bool paintLayer(bool border);
 };
 extern Component Z;
 extern Component C;
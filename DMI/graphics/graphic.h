@@ -15,7 +15,8 @@ enum graphic_type
     RECTANGLE,
     LINE,
     CIRCLE,
-    SOLID_ARC
+    SOLID_ARC,
+    TEXT
 };
 class graphic
 {
@@ -20,5 +20,7 @@ class text_graphic : public texture
     int alignment;
     int aspect;
     Color color;
+    // Set when the text is drawn glyph by glyph instead of from tex
+    std::shared_ptr<UiPlatform::Font> font;
 };
 #endif
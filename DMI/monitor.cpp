@@ -9,6 +9,8 @@
 #include "monitor.h"
 #include "distance/distance.h"
 #include "sound/sound.h"
+#include "platform_runtime.h"
+#include <algorithm>
 MonitoringStatus monitoring;
 SupervisionStatus supervision;
 Level level = Level::Unknown;
@@ -64,6 +66,34 @@ void setSpeeds(float vtarg, float vperm, float vsbi, float vrelease, float vest,
     Vest = vest;
     Dtarg = dist;
 }
+// Needle movement between two kinematics samples
+bool needle_interpolation = false;
+static float needle_from;
+static float needle_to;
+static int64_t needle_start;
+static int64_t needle_interval = 50;
+static uint32_t last_sample_time;
+void addSpeedSample(float vest, uint32_t time)
+{
+    float current = getNeedleSpeed();
+    if (needle_interpolation)
+        needle_interval = std::clamp<int64_t>((int32_t)(time - last_sample_time), 20, 200);
+    else
+        current = vest;
+    needle_interpolation = true;
+    last_sample_time = time;
+    needle_from = current;
+    needle_to = vest;
+    needle_start = platform->get_timer();
+    Vest = vest;
+}
+float getNeedleSpeed()
+{
+    if (!needle_interpolation)
+        return Vest;
+    float f = std::min(1.0f, (platform->get_timer() - needle_start) / (float)needle_interval);
+    return needle_from + (needle_to - needle_from) * f;
+}
 void setMonitor(MonitoringStatus status)
 {
     if(monitoring == CSM && (status == TSM || status == RSM)) playSinfo();
@@ -9,6 +9,7 @@
 #ifndef _MONITOR_H
 #define _MONITOR_H
 #include <string>
+#include <cstdint>
 #include "../EVC/Supervision/common.h"
 extern Level level;
 extern int nid_ntc;
@@ -47,6 +48,12 @@ extern bool bot_driver;
 extern bool ovEOA;
 void update();
 void setSpeeds(float vtarg, float vperm, float vsbi, float vrelease, float vest, float dist);
+// Speed samples from the kinematics channel, in km/h and EVC milliseconds.
+// The needle moves from the displayed speed to each new sample
+// over the interval between samples.
+extern bool needle_interpolation;
+void addSpeedSample(float vest, uint32_t time);
+float getNeedleSpeed();
 void setMonitor(MonitoringStatus status);
 void setSupervision(SupervisionStatus status);
 #endif
\ No newline at end of file
@@ -23,7 +23,7 @@ const int posy[] = {283,250,206,182,164,150,107,64,21};
 const int divs[] = { 0, 25, 50, 75, 100, 125, 250, 500, 1000 };
 int planning_scale = 4;
 const int object_pos[] = {55,80,105};
-Component planning_distance(246,300, displayPlanning);
+Component planning_distance(246,300);
 Component planning_objects(246,300, displayObjects);
 Component planning_gradient(18,270, displayGradient);
 Component PASP(99,270, displayPASP);
@@ -255,6 +255,8 @@ void speedLines()
 }
 void planningConstruct(window *w)
 {
+    planning_distance.setLayerDisplay(displayPlanning);
+    planning_distance.retained = true;
     w->addToLayout(&planning_distance, new RelativeAlignment(nullptr, 334,15));
     w->addToLayout(&planning_objects, new RelativeAlignment(nullptr, 334,15, 0));
     w->addToLayout(&zoomout, new RelativeAlignment(&planning_distance, 20,8,0));
@@ -69,6 +69,8 @@ float speedToAngle(float speed)
 
 void drawNeedle()
 {
+    // The colour follows the displayed speed, not the latest sample
+    float vneedle = getNeedleSpeed();
     Color needleColor = Grey;
     if(mode == Mode::SB || mode == Mode::NL || mode == Mode::PT || mode == Mode::IS)
     {
@@ -81,7 +83,7 @@ void drawNeedle()
 #if BASELINE == 4
     else if (mode == Mode::AD)
     {
-        needleColor = Vtarget<=Vest || monitoring == RSM ? White : Grey;
+        needleColor = Vtarget<=vneedle || monitoring == RSM ? White : Grey;
     }
 #endif
     else if(supervision == IntS)
@@ -90,19 +92,19 @@ void drawNeedle()
     }
     else
     {
-        if(monitoring == RSM && Vest<=Vrelease && Vrelease!=0) needleColor = Yellow;
-        if(Vtarget<=Vest && Vest<=Vperm && Vtarget<Vperm && Vtarget>=0 && mode != Mode::LS)
+        if(monitoring == RSM && vneedle<=Vrelease && Vrelease!=0) needleColor = Yellow;
+        if(Vtarget<=vneedle && vneedle<=Vperm && Vtarget<Vperm && Vtarget>=0 && mode != Mode::LS)
         {
             if(monitoring==TSM) needleColor = Yellow;
             if(monitoring==CSM) needleColor = White;
         }
-        if((Vest>Vperm && monitoring!=RSM) || (Vest>Vrelease && monitoring==RSM))
+        if((vneedle>Vperm && monitoring!=RSM) || (vneedle>Vrelease && monitoring==RSM))
         {
             needleColor = Orange;
         }
     }
     Color speedColor = needleColor == Red ? White : Black;
-    float an = speedToAngle(useImperialSystem ? Vest * KMH_TO_MPH : Vest);
+    float an = speedToAngle(useImperialSystem ? vneedle * KMH_TO_MPH : vneedle);
     platform->set_color(needleColor);
     csg.drawCircle(25,cx,cy);
     float pax[] = { 1.5f, 1.5f, -1.5f, -1.5f };
@@ -121,8 +123,8 @@ void drawNeedle()
             spd_nums[i] = csg.getText(to_string(i), 0, 0, 18, speedColor, RIGHT);
         }
     }
-    int spd = useImperialSystem ? Vest * KMH_TO_MPH : Vest;
-    spd = Vest-spd > 0.01 ? spd + 1 : spd;
+    int spd = useImperialSystem ? vneedle * KMH_TO_MPH : vneedle;
+    spd = vneedle-spd > 0.01 ? spd + 1 : spd;
     int c[3] = {spd/100%10, spd/10%10, (spd%10)};
     bool firstPrint = false;
     for(int i=0; i<3; i++)
@@ -305,10 +307,11 @@ void displayCSG()
     }
 }
 int prevMaxSpeed = 0;
-void displayLines(bool redraw)
+// Either adds the speed labels to the gauge or draws the speed lines
+void displayLines(bool labels)
 {
     std::unique_ptr<UiPlatform::Font> gaugeFont;
-    if (redraw)
+    if (labels)
         gaugeFont = platform->load_font(16, false, "");
     platform->set_color(White);
 
@@ -327,7 +330,7 @@ void displayLines(bool redraw)
         int longinterval = maxSpeed == 400 ? 50 : (maxSpeed == 150 ? 25 : 20);
 #endif
         rminline = i%longinterval!=0 ? -110 : -100;
-        if(redraw && i%longinterval == 0 && (maxSpeed != 400 || (i!=250 && i!=350)))
+        if(labels && i%longinterval == 0 && (maxSpeed != 400 || (i!=250 && i!=350)))
         {
             std::string s = to_string(i);
             std::pair<float, float> wh = gaugeFont->calc_size(s);
@@ -357,9 +360,14 @@ void displayLines(bool redraw)
             t->tex = platform->make_text_image(s, *gaugeFont, White);
             csg.add(t);
         }
-        csg.drawRadius(cx, cy, rminline, -125, an);
+        if(!labels) csg.drawRadius(cx, cy, rminline, -125, an);
     }
 }
+// Static part of the gauge, kept in the retained layer of csg
+void displayDial()
+{
+    displayLines(false);
+}
 Component releaseRegion(36,36, displayVrelease);
 static float prevVrelease=0;
 bool releaseSignShown=false;
@@ -417,9 +425,9 @@ void displayGauge()
             }
         }
         csg.clear();
+        displayLines(true);
     }
 
-    displayLines(!inited);
     displayCSG();
     drawNeedle();
     drawImperialIndicator();
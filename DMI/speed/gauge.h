@@ -9,6 +9,7 @@
 #ifndef _GAUGE_H
 #define _GAUGE_H
 void displayGauge();
+void displayDial();
 void displayVrelease();
 void setLSSMA(int nlssma);
 extern int prevMaxSpeed;
@@ -13,6 +13,7 @@ Component time_hour;
 void setupTimeHour()
 {
     time_hour = Component(63, softkeys ? 30 : 50,timeHour);
+    time_hour.glyphText = true;
 }
 void timeHour()
 {
@@ -23,6 +23,7 @@
 #include "../speed/gauge.h"
 #include "../Config/config.h"
 #include "../softkeys/softkey.h"
+#include "../../EVC/DMI/status_frame.h"
 #include "platform_runtime.h"
 
 int WallClockTime::hour;
@@ -40,16 +41,6 @@ void fill_non_existent(json &j, std::string str, std::nullptr_t null)
 {
     if (!j.contains("str")) j[str] = nullptr;
 }
-void from_json(const json&j, speed_element &e)
-{
-    e.distance = j["DistanceToTrainM"].get<double>();
-    e.speed = std::round(j["TargetSpeedMpS"].get<double>()*3.6);
-}
-void from_json(const json&j, gradient_element &e)
-{
-    e.distance = j["DistanceToTrainM"].get<double>();
-    e.val = j["GradientPerMille"].get<double>();
-}
 enum struct TrackConditionType
 {
     Custom,
@@ -81,11 +72,8 @@ enum struct TractionSystem
     DC1500V,
     DC750V
 };
-void from_json(const json&j, planning_element &e)
+static int planning_condition(TrackConditionType type, bool yellow, TractionSystem traction)
 {
-    e.distance = j["DistanceToTrainM"].get<double>();
-    TrackConditionType type = (TrackConditionType)j["Type"].get<int>();
-    bool yellow = j["YellowColour"].get<bool>();
     int tex = 0;
     switch(type)
     {
@@ -125,8 +113,7 @@ void from_json(const json&j, planning_element &e)
         case TrackConditionType::SoundHorn:
             tex = 24;
             break;
-        case TrackConditionType::TractionSystemChange:{
-            TractionSystem traction = (TractionSystem)j["TractionSystem"].get<int>();
+        case TrackConditionType::TractionSystemChange:
             switch(traction)
             {
                 case TractionSystem::NonFitted:
@@ -150,7 +137,7 @@ void from_json(const json&j, planning_element &e)
                 default:
                     break;
             }
-            break;}
+            break;
         case TrackConditionType::Tunnel:
             tex = 40;
             break;
@@ -166,8 +153,179 @@ void from_json(const json&j, planning_element &e)
         default:
             break;
     }
-    e.condition = tex;
+    return tex;
+}
+void from_json(const json&j, dmi_status_frame::speed_target &e)
+{
+    e.Distance = j["DistanceToTrainM"].get<double>();
+    e.Speed = j["TargetSpeedMpS"].get<double>();
+}
+void from_json(const json&j, dmi_status_frame::gradient &e)
+{
+    e.Distance = j["DistanceToTrainM"].get<double>();
+    e.Gradient = j["GradientPerMille"].get<double>();
+}
+void from_json(const json&j, dmi_status_frame::track_condition &e)
+{
+    e.Distance = j["DistanceToTrainM"].get<double>();
+    e.Type = j["Type"].get<int>();
+    e.TractionSystem = j.value("TractionSystem", 0);
+    e.YellowColour = j["YellowColour"].get<bool>();
+}
+void from_json(const json&j, dmi_status_frame &s)
+{
+    s.flags = 0;
+    s.AllowedSpeed = j["AllowedSpeedMpS"].get<double>();
+    s.TargetSpeed = j["TargetSpeedMpS"].get<double>();
+    s.InterventionSpeed = j["InterventionSpeedMpS"].get<double>();
+    s.TargetDistance = j["TargetDistanceM"].get<double>();
+    s.ReleaseSpeed = j["ReleaseSpeedMpS"].get<double>();
+    s.Speed = j["SpeedMpS"].get<double>();
+    s.TimeToPermitted = j["TimeToPermittedS"].get<double>();
+    s.TimeToIndication = j["TimeToIndicationS"].get<double>();
+    s.MonitoringStatus = j["CurrentMonitoringStatus"].get<int>();
+    s.SupervisionStatus = j["CurrentSupervisionStatus"].get<int>();
+    s.Mode = j["CurrentMode"].get<int>();
+    s.Level = j["CurrentLevel"].get<int>();
+    s.set(dmi_status_frame::SlipperyRail, j["SlipperyRail"].get<bool>());
+    s.set(dmi_status_frame::BotDriver, j["BotDriver"].get<bool>());
+    if (j.contains("CurrentNTC")) s.NTC = j["CurrentNTC"].get<int>();
+    s.set(dmi_status_frame::HasGeographicalPosition, !j["GeographicalPositionKM"].is_null());
+    if (!j["GeographicalPositionKM"].is_null()) s.GeographicalPosition = j["GeographicalPositionKM"].get<double>();
+    const json &clock = j["WallClockTime"];
+    s.Hour = clock["Hour"];
+    s.Minute = clock["Minute"];
+    s.Second = clock["Second"];
+    s.set(dmi_status_frame::HasModeAcknowledgement, !j["ModeAcknowledgement"].is_null());
+    if (!j["ModeAcknowledgement"].is_null()) s.ModeAcknowledgement = j["ModeAcknowledgement"].get<int>();
+    const json &transition = j["LevelTransition"];
+    s.set(dmi_status_frame::HasLevelTransition, !transition.is_null());
+    if (!transition.is_null()) {
+        s.LevelTransitionLevel = transition["Level"].get<int>();
+        if (transition.contains("NTC")) s.LevelTransitionNTC = transition["NTC"].get<int>();
+        s.set(dmi_status_frame::LevelTransitionAcknowledge, transition["Acknowledge"].get<bool>());
+    }
+    s.set(dmi_status_frame::OverrideActive, j["OverrideActive"].get<bool>());
+    s.RadioStatus = j["RadioStatus"].get<int>();
+    s.set(dmi_status_frame::BrakeCommanded, j["BrakeCommanded"].get<bool>());
+    s.set(dmi_status_frame::DisplayTAF, j["DisplayTAF"].get<bool>());
+    s.set(dmi_status_frame::HasLSSMA, j.contains("LSSMA"));
+    if (j.contains("LSSMA")) s.LSSMA = j["LSSMA"].get<double>();
+    s.set(dmi_status_frame::AllowedAck, j.contains("AllowedAck") && j["AllowedAck"].get<bool>());
+    s.set(dmi_status_frame::BrakeAcknowledge, j["BrakeAcknowledge"].get<bool>());
+    bool marker = j.contains("IndicationMarkerTarget") && !j["IndicationMarkerTarget"].is_null();
+    s.set(dmi_status_frame::HasIndicationMarker, marker);
+    if (marker) {
+        s.IndicationMarkerTarget = j["IndicationMarkerTarget"].get<dmi_status_frame::speed_target>();
+        s.IndicationMarkerDistance = j["IndicationMarkerDistanceM"].is_null() ? 0 : j["IndicationMarkerDistanceM"].get<double>();
+    }
+    s.SpeedTargets = j["SpeedTargets"].get<std::vector<dmi_status_frame::speed_target>>();
+    s.GradientProfile = j["GradientProfile"].get<std::vector<dmi_status_frame::gradient>>();
+    s.PlanningTrackConditions = j["PlanningTrackConditions"].get<std::vector<dmi_status_frame::track_condition>>();
+    s.ActiveTrackConditions = j["ActiveTrackConditions"].get<std::vector<int>>();
+    s.updated = dmi_status_frame::AllGroups;
+}
+static void apply_speeds(double allowed, double target, double intervention, double distance, double release)
+{
+    if (level != Level::NTC || (mode != Mode::SN && mode != Mode::NL))
+    {
+        Vperm = (int)(allowed*3.6+0.01);
+        Vtarget = round(target*3.6);
+        Vsbi = (int)(intervention*3.6+0.01);
+        Dtarg = round(distance);
+        Vrelease = round(release*3.6);
+    }
+}
+static void apply_kinematics(const dmi_kinematics_frame &k)
+{
+    apply_speeds(k.AllowedSpeed, k.TargetSpeed, k.InterventionSpeed, k.TargetDistance, k.ReleaseSpeed);
+    addSpeedSample(k.Speed*3.6, k.Time);
+    TTI = k.TimeToIndication;
+    setMonitor((MonitoringStatus)k.MonitoringStatus);
+    setSupervision((SupervisionStatus)k.SupervisionStatus);
+    mode = (Mode)k.Mode;
+}
+static void apply_status(const dmi_status_frame &s)
+{
+    // Once the kinematics channel is active, it is the only source of speeds,
+    // supervision status and mode, as it is newer than any status frame
+    if (!needle_interpolation) {
+        apply_speeds(s.AllowedSpeed, s.TargetSpeed, s.InterventionSpeed, s.TargetDistance, s.ReleaseSpeed);
+        Vest = s.Speed*3.6;
+        TTI = s.TimeToIndication;
+        setMonitor((MonitoringStatus)s.MonitoringStatus);
+        setSupervision((SupervisionStatus)s.SupervisionStatus);
+        mode = (Mode)s.Mode;
+    }
+    TTP = s.TimeToPermitted;
+    level = (Level)s.Level;
+    slippery_rail = s.has(dmi_status_frame::SlipperyRail);
+    bot_driver = s.has(dmi_status_frame::BotDriver);
+    if (level == Level::NTC) nid_ntc = s.NTC;
+    if (!s.has(dmi_status_frame::HasGeographicalPosition)) pk = -1;
+    else pk = s.GeographicalPosition;
+    WallClockTime::hour = s.Hour;
+    WallClockTime::minute = s.Minute;
+    WallClockTime::second = s.Second;
+    if (s.has(dmi_status_frame::HasModeAcknowledgement))
+    {
+        ackMode = (Mode)s.ModeAcknowledgement;
+        setAck(AckType::Mode, 0, true);
+    }
+    else
+    {
+        setAck(AckType::Mode, 0, false);
+    }
+    if (s.has(dmi_status_frame::HasLevelTransition))
+    {
+        ackLevel = (Level)s.LevelTransitionLevel;
+        if (ackLevel == Level::NTC) ackNTC = s.LevelTransitionNTC;
+        setAck(AckType::Level, s.has(dmi_status_frame::LevelTransitionAcknowledge)+1, true);
+    }
+    else
+    {
+        setAck(AckType::Level, 0, false);
+    }
+    ovEOA = s.has(dmi_status_frame::OverrideActive);
+    radioStatus = s.RadioStatus;
+    EB = SB = s.has(dmi_status_frame::BrakeCommanded);
+    extern bool display_taf;
+    display_taf = s.has(dmi_status_frame::DisplayTAF);
+    if (s.has(dmi_status_frame::HasLSSMA)) setLSSMA((int)(s.LSSMA*3.6 + 0.01));
+    else setLSSMA(-1);
+    extern bool ackAllowed;
+    ackAllowed = s.has(dmi_status_frame::AllowedAck);
+    setAck(AckType::Brake, 0, s.has(dmi_status_frame::BrakeAcknowledge));
+    // Lists are only rebuilt when a delta frame carries them
+    if (s.updated & dmi_status_frame::SpeedTargetsGroup) {
+        speed_elements.clear();
+        for (auto &e : s.SpeedTargets)
+            speed_elements.push_back({(int)std::round(e.Speed*3.6), (float)e.Distance});
+    }
+    if (!s.has(dmi_status_frame::HasIndicationMarker)) {
+        imarker.start_distance = 0;
+    } else {
+        imarker.start_distance = s.IndicationMarkerDistance;
+        imarker.element = {(int)std::round(s.IndicationMarkerTarget.Speed*3.6), (float)s.IndicationMarkerTarget.Distance};
+    }
+    if (s.updated & dmi_status_frame::GradientGroup) {
+        gradient_elements.clear();
+        for (auto &e : s.GradientProfile)
+            gradient_elements.push_back({e.Gradient, (float)e.Distance});
+    }
+    if (s.updated & dmi_status_frame::PlanningGroup) {
+        planning_elements.clear();
+        for (auto &e : s.PlanningTrackConditions)
+            planning_elements.push_back({planning_condition((TrackConditionType)e.Type, e.YellowColour, (TractionSystem)e.TractionSystem), (float)e.Distance});
+    }
+    if (s.updated & dmi_status_frame::ActiveConditionsGroup) {
+        void updateTc(std::set<int> &syms);
+        std::set<int> syms(s.ActiveTrackConditions.begin(), s.ActiveTrackConditions.end());
+        updateTc(syms);
+    }
 }
+// Last window received while the status arrives in binary form
+static json binary_window;
 void parseData(std::string str)
 {
     int index = str.find_first_of('(');
@@ -204,6 +362,7 @@ void parseData(std::string str)
     else if (command == "stmData")
     {
         bit_manipulator r(value);
+        if (r.error) return;
         stm_message msg(r);
         parse_stm_message(msg);
     }
@@ -232,82 +391,29 @@ void parseData(std::string str)
         if (command[3] == 'F') softF[stoi(command.substr(4, 1))].setPressed(value == "1" || value == "true");
         else if (command[3] == 'H') softH[stoi(command.substr(4, 1))].setPressed(value == "1" || value == "true");
     }
-    if (command != "json") return;
-    json j = json::parse(value);
-    setWindow(j);
-    if (!j.contains("Status")) return;
-    j = j["Status"];
-    /*fill_non_existent(j, "TargetSpeedMpS", 1000);
-    fill_non_existent(j, "ReleaseSpeedMpS", 0);
-    fill_non_existent(j, "ModeAcknowledgement", nullptr);
-    fill_non_existent(j, "LevelTransition", nullptr);*/
-    if (level != Level::NTC || (mode != Mode::SN && mode != Mode::NL))
-    {
-        Vperm = (int)(j["AllowedSpeedMpS"].get<double>()*3.6+0.01);
-        Vtarget = round(j["TargetSpeedMpS"].get<double>()*3.6);
-        Vsbi = (int)(j["InterventionSpeedMpS"].get<double>()*3.6+0.01);
-        Dtarg = round(j["TargetDistanceM"].get<double>());
-        Vrelease = round(j["ReleaseSpeedMpS"].get<double>()*3.6);
-    }
-    Vest = j["SpeedMpS"].get<double>()*3.6;
-    TTP = j["TimeToPermittedS"].get<double>();
-    TTI = j["TimeToIndicationS"].get<double>();
-    setMonitor((MonitoringStatus)j["CurrentMonitoringStatus"].get<int>());
-    setSupervision((SupervisionStatus)j["CurrentSupervisionStatus"].get<int>());
-    mode = (Mode)j["CurrentMode"].get<int>();
-    level = (Level)j["CurrentLevel"].get<int>();
-    slippery_rail = j["SlipperyRail"].get<bool>();
-    bot_driver = j["BotDriver"].get<bool>();
-    if (level == Level::NTC) nid_ntc = j["CurrentNTC"].get<int>();
-    if (j["GeographicalPositionKM"].is_null()) pk = -1;
-    else pk = j["GeographicalPositionKM"].get<double>();
-    json &clock = j["WallClockTime"];
-    WallClockTime::hour = clock["Hour"];
-    WallClockTime::minute = clock["Minute"];
-    WallClockTime::second = clock["Second"];
-    if (!j["ModeAcknowledgement"].is_null())
+    if (command == "kinematics")
     {
-        ackMode = (Mode)j["ModeAcknowledgement"].get<int>();
-        setAck(AckType::Mode, 0, true);
+        dmi_kinematics_frame kinematics;
+        if (kinematics.decode(value))
+            apply_kinematics(kinematics);
+        return;
     }
-    else
+    if (command == "status")
     {
-        setAck(AckType::Mode, 0, false);
-    }
-    if (!j["LevelTransition"].is_null())
-    {
-        ackLevel = (Level)j["LevelTransition"]["Level"].get<int>();
-        if (ackLevel == Level::NTC) ackNTC = j["LevelTransition"]["NTC"].get<int>();
-        setAck(AckType::Level, j["LevelTransition"]["Acknowledge"].get<bool>()+1, true);
-    }
-    else
-    {
-        setAck(AckType::Level, 0, false);
-    }
-    ovEOA = j["OverrideActive"].get<bool>();
-    radioStatus = j["RadioStatus"].get<int>();
-    EB = SB = j["BrakeCommanded"].get<bool>();
-    extern bool display_taf;
-    display_taf = j["DisplayTAF"].get<bool>();
-    if (j.contains("LSSMA")) setLSSMA((int)(j["LSSMA"].get<double>()*3.6 + 0.01));
-    else setLSSMA(-1);
-    extern bool ackAllowed;
-    ackAllowed = j.contains("AllowedAck") && j["AllowedAck"];
-    setAck(AckType::Brake, 0, j["BrakeAcknowledge"].get<bool>());
-    {
-        speed_elements = j["SpeedTargets"].get<std::vector<speed_element>>();
-        if (j["IndicationMarkerDistanceM"].is_null()) imarker.start_distance = 0;
-        else imarker.start_distance = j["IndicationMarkerDistanceM"].get<double>();
-        if (!j["IndicationMarkerTarget"].is_null()) imarker.element = j["IndicationMarkerTarget"].get<speed_element>();
-        gradient_elements = j["GradientProfile"].get<std::vector<gradient_element>>();
-        planning_elements = j["PlanningTrackConditions"].get<std::vector<planning_element>>();
-        
-    }
-    {
-        void updateTc(std::set<int> &syms);
-        std::set<int> syms = j["ActiveTrackConditions"].get<std::set<int>>();
-        updateTc(syms);
+        static dmi_status_frame status;
+        if (!status.decode(value)) return;
+        setWindow(binary_window);
+        apply_status(status);
+        return;
     }
+    if (command != "json") return;
+    json j = json::parse(value);
+    if (j.contains("ActiveWindow") && !j.contains("Status")) binary_window = j;
+    setWindow(j);
+    if (!j.contains("Status")) return;
+    static dmi_status_frame status;
+    from_json(j["Status"], status);
+    apply_status(status);
 }
 std::unique_ptr<BasePlatform::BusSocket> evc_socket;
 uint32_t evc_peer;
@@ -317,13 +423,18 @@ void data_received(BasePlatform::BusSocket::ReceiveResult &&result)
 
     if (std::holds_alternative<BasePlatform::BusSocket::JoinNotification>(result)) {
         auto &join = std::get<BasePlatform::BusSocket::JoinNotification>(result);
-        if (!evc_peer && join.peer.tid == BasePlatform::BusSocket::PeerId::fourcc("EVC"))
+        if (!evc_peer && join.peer.tid == BasePlatform::BusSocket::PeerId::fourcc("EVC")) {
             evc_peer = join.peer.uid;
+            // Older EVCs ignore the offer and keep sending JSON
+            evc_socket->send_to(evc_peer, "protocol(delta)");
+        }
     }
     if (std::holds_alternative<BasePlatform::BusSocket::LeaveNotification>(result)) {
         auto &leave = std::get<BasePlatform::BusSocket::LeaveNotification>(result);
         if (leave.peer.uid == evc_peer) {
             evc_peer = 0;
+            binary_window = json();
+            needle_interpolation = false;
             load_config({});
             revokeMessages();
         }
@@ -12,6 +12,7 @@
 #include "../graphics/text_button.h"
 #include "../graphics/tra_components.h"
 #include "../STM/stm_objects.h"
+#include "../speed/gauge.h"
 
 void planningConstruct(window *w);
 void construct_nav(window *w, bool custom);
@@ -100,6 +101,12 @@ void construct_main(window *w, bool custom)
     }
     int offset = softkeys ? 0 : 15;
     w->addToLayout(&csg, new RelativeAlignment(nullptr, 54, offset));
+    csg.setLayerDisplay(displayDial);
+    csg.retained = true;
+    // Speed digits, release speed and target distance change continuously
+    csg.glyphText = true;
+    releaseRegion.glyphText = true;
+    a2.glyphText = true;
     w->addToLayout(&a2, new RelativeAlignment(nullptr, 0, 54+offset));
     w->addToLayout(&a23, new RelativeAlignment(nullptr, 0, 54+offset));
     w->addToLayout(&distanceBar, new RelativeAlignment(nullptr, 0, 84+offset));
@@ -30,6 +30,7 @@ extern bool message_when_driver_ack_mode;
 extern bool message_when_driver_ack_mode;
 extern bool entering_mode_message_is_time_dependent;
 extern bool asc_fitted;
+extern int dmi_kinematics_rate;
 extern std::map<std::string, std::string> const_train_data;
 extern std::map<std::string, std::vector<std::string>> custom_train_data_inputs;
 
@@ -61,6 +62,7 @@ void load_config(std::string serie)
 		message_when_driver_ack_mode = cfg.value("MessageWhenModeAck", false);
 		message_when_driver_ack_level = cfg.value("MessageWhenLevelAck", false);
 		entering_mode_message_is_time_dependent = cfg.value("EnteringModeMessageIsTimeDependent", false);
+		dmi_kinematics_rate = cfg.value("DMIKinematicsRate", 0);
 		const_train_data.clear();
 		if (cfg.contains("ConstTrainDataValues"))
 		{
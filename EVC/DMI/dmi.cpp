@@ -32,6 +32,7 @@
 #include "text_message.h"
 #include "windows.h"
 #include "acks.h"
+#include "status_frame.h"
 #include "platform_runtime.h"
 
 using std::map;
@@ -41,6 +42,26 @@ using std::string;
 using std::to_string;
 int dmi_pid;
 std::unique_ptr<BasePlatform::BusSocket> dmi_socket;
+enum struct dmi_protocol
+{
+    Json,
+    Binary,
+    Delta
+};
+// Status encoding negotiated by each connected DMI
+struct dmi_peer
+{
+    dmi_protocol protocol = dmi_protocol::Json;
+    // The bus delivers in order, so the last frame sent is the one
+    // the DMI holds when the next delta arrives
+    dmi_status_frame last_status;
+    int frames_since_keyframe = -1;
+};
+// Number of delta frames between two keyframes
+static const int dmi_keyframe_period = 50;
+std::map<uint32_t, dmi_peer> dmi_peers;
+// Active window as last sent to binary peers
+json dmi_binary_window;
 void dmi_receive(BasePlatform::BusSocket::JoinNotification &&msg);
 void dmi_receive(BasePlatform::BusSocket::LeaveNotification &&msg);
 void dmi_receive(BasePlatform::BusSocket::Message &&msg);
@@ -213,6 +234,7 @@ std::map<string, string> persistent_commands;
 void dmi_receive(BasePlatform::BusSocket::JoinNotification &&msg)
 {
     if (msg.peer.tid == BasePlatform::BusSocket::PeerId::fourcc("DMI")) {
+        dmi_peers[msg.peer.uid] = dmi_peer();
         for (const auto &entry : persistent_commands)
             dmi_socket->send_to(msg.peer.uid, entry.first+"("+entry.second+")");
         for (auto &t : messages) {
@@ -221,9 +243,17 @@ void dmi_receive(BasePlatform::BusSocket::JoinNotification &&msg)
     }
 }
 void dmi_receive(BasePlatform::BusSocket::LeaveNotification &&msg) {
+    dmi_peers.erase(msg.peer.uid);
 }
 void dmi_receive(BasePlatform::BusSocket::Message &&msg)
 {
+    if (msg.data == "protocol(binary)" || msg.data == "protocol(delta)") {
+        dmi_peer &peer = dmi_peers[msg.peer.uid];
+        peer.protocol = msg.data == "protocol(delta)" ? dmi_protocol::Delta : dmi_protocol::Binary;
+        peer.frames_since_keyframe = -1;
+        dmi_binary_window = json();
+        return;
+    }
     parse_command(std::move(msg.data));
 }
 bool sendtoor=false;
@@ -241,29 +271,19 @@ void send_command(string command, string value)
         sim_write_line("noretain(etcs::dmi::command="+command+"("+value+"))");
 }
 double calc_ceiling_limit();
-struct speed_element
-{
-    double Distance;
-    double Speed;
-};
-struct gradient_element
-{
-    double Distance;
-    int Gradient;
-};
-void to_json(json&j, const speed_element &e)
+void to_json(json&j, const dmi_status_frame::speed_target &e)
 {
     j["DistanceToTrainM"] = e.Distance;
     j["TargetSpeedMpS"] = e.Speed;
 }
-void to_json(json&j, const gradient_element &e)
+void to_json(json&j, const dmi_status_frame::gradient &e)
 {
     j["DistanceToTrainM"] = e.Distance;
     j["GradientPerMille"] = e.Gradient;
 }
-void to_json(json&j, const PlanningTrackCondition &e)
+void to_json(json&j, const dmi_status_frame::track_condition &e)
 {
-    j["DistanceToTrainM"] = e.DistanceToTrainM;
+    j["DistanceToTrainM"] = e.Distance;
     j["YellowColour"] = e.YellowColour;
     j["Type"] = e.Type;
     j["TractionSystem"] = e.TractionSystem;
@@ -274,68 +294,129 @@ void to_json(json&j, const text_message &t)
     j["FirstGroup"] = t.firstGroup;
     j["Acknowledge"] = t.ack;
 }
-void dmi_update_func()
+void to_json(json&j, const dmi_status_frame &s)
+{
+    j["BotDriver"] = s.has(dmi_status_frame::BotDriver);
+    j["SlipperyRail"] = s.has(dmi_status_frame::SlipperyRail);
+    j["AllowedSpeedMpS"] = s.AllowedSpeed;
+    j["InterventionSpeedMpS"] = s.InterventionSpeed;
+    j["TargetSpeedMpS"] = s.TargetSpeed;
+    j["TargetDistanceM"] = s.TargetDistance;
+    j["SpeedMpS"] = s.Speed;
+    j["ReleaseSpeedMpS"] = s.ReleaseSpeed;
+    j["CurrentMonitoringStatus"] = s.MonitoringStatus;
+    j["CurrentSupervisionStatus"] = s.SupervisionStatus;
+    j["CurrentMode"] = s.Mode;
+    j["CurrentLevel"] = s.Level;
+    if (s.Level == (int)Level::NTC)
+        j["CurrentNTC"] = s.NTC;
+    j["TimeToPermittedS"] = s.TimeToPermitted;
+    j["TimeToIndicationS"] = s.TimeToIndication;
+    if (s.has(dmi_status_frame::HasModeAcknowledgement)) j["ModeAcknowledgement"] = s.ModeAcknowledgement;
+    else j["ModeAcknowledgement"] = nullptr;
+    if (s.has(dmi_status_frame::HasLevelTransition)) {
+        j["LevelTransition"]["Acknowledge"] = s.has(dmi_status_frame::LevelTransitionAcknowledge);
+        j["LevelTransition"]["Level"] = s.LevelTransitionLevel;
+        if (s.LevelTransitionLevel == (int)Level::NTC)
+            j["LevelTransition"]["NTC"] = s.LevelTransitionNTC;
+    } else {
+        j["LevelTransition"] = nullptr;
+    }
+    j["OverrideActive"] = s.has(dmi_status_frame::OverrideActive);
+    j["RadioStatus"] = s.RadioStatus;
+    j["BrakeCommanded"] = s.has(dmi_status_frame::BrakeCommanded);
+    j["BrakeAcknowledge"] = s.has(dmi_status_frame::BrakeAcknowledge);
+    if (s.has(dmi_status_frame::HasGeographicalPosition)) j["GeographicalPositionKM"] = s.GeographicalPosition;
+    else j["GeographicalPositionKM"]=nullptr;
+    j["DisplayTAF"] = s.has(dmi_status_frame::DisplayTAF);
+    j["AllowedAck"] = s.has(dmi_status_frame::AllowedAck);
+    j["ReversingPermitted"] = s.has(dmi_status_frame::ReversingPermitted);
+    json clock;
+    clock["Hour"] = s.Hour;
+    clock["Minute"] = s.Minute;
+    clock["Second"] = s.Second;
+    j["WallClockTime"] = clock;
+    if (s.has(dmi_status_frame::HasLSSMA)) j["LSSMA"] = s.LSSMA;
+    if (s.has(dmi_status_frame::HasIndicationMarker)) {
+        j["IndicationMarkerTarget"] = s.IndicationMarkerTarget;
+        j["IndicationMarkerDistanceM"] = s.IndicationMarkerDistance;
+    } else {
+        j["IndicationMarkerTarget"] = nullptr;
+        j["IndicationMarkerDistanceM"] = nullptr;
+    }
+    j["SpeedTargets"] = s.SpeedTargets;
+    j["GradientProfile"] = s.GradientProfile;
+    j["PlanningTrackConditions"] = s.PlanningTrackConditions;
+    j["ActiveTrackConditions"] = s.ActiveTrackConditions;
+}
+// Returns false if the DMI bus is not available
+static bool check_dmi_socket()
 {
     if ((!cab_active[0] && !cab_active[1]) || mode == Mode::NP || mode == Mode::PS || mode == Mode::SL) {
         dmi_socket = nullptr;
-        platform->delay(100).then(dmi_update_func).detach();
-        return;
+        dmi_peers.clear();
+        return true;
     }
     if (!dmi_socket) {
         dmi_socket = platform->open_socket("evc_dmi", BasePlatform::BusSocket::PeerId::fourcc("EVC"));
         if (!dmi_socket)
-            return;
+            return false;
         dmi_socket->receive().then(dmi_receive_handler).detach();
     }
+    return true;
+}
+void dmi_update_func()
+{
+    if (!check_dmi_socket())
+        return;
     platform->delay(100).then(dmi_update_func).detach();
-    sendtoor = get_milliseconds() - lastor > 250;
-    if (sendtoor) lastor = get_milliseconds();
-    json j;
-    j["BotDriver"] = bot_driver;
-    j["SlipperyRail"] = slippery_rail_driver;
-    j["AllowedSpeedMpS"] = V_perm;
-    j["InterventionSpeedMpS"] = V_sbi;
-    j["TargetSpeedMpS"] = V_target;
-    j["TargetDistanceM"] = D_target;
-    j["SpeedMpS"] = V_est;
-    j["ReleaseSpeedMpS"] = V_release;
-    j["CurrentMonitoringStatus"] = (int)monitoring;
-    j["CurrentSupervisionStatus"] = (int)supervision;
-    j["CurrentMode"] = (int)mode;
-    j["CurrentLevel"] = (int)(level_valid ? level : Level::Unknown);
-    if (level == Level::NTC)
-        j["CurrentNTC"] = nid_ntc;
-    j["TimeToPermittedS"] = TTP;
-    j["TimeToIndicationS"] = TTI;
-    if (mode_acknowledgeable) j["ModeAcknowledgement"] = (int)mode_to_ack;
-    else j["ModeAcknowledgement"] = nullptr;
-    if (ongoing_transition || level_acknowledgeable) {
-        j["LevelTransition"]["Acknowledge"] = level_acknowledgeable;
-        j["LevelTransition"]["Level"] = (int)level_to_ack;
-        if (level_to_ack == Level::NTC)
-            j["LevelTransition"]["NTC"] = ntc_to_ack;
-    } else {
-        j["LevelTransition"] = nullptr;
-    }
-    j["OverrideActive"] = overrideProcedure;
-    j["RadioStatus"] = (int)radio_status_driver;
-    j["BrakeCommanded"] = EB_command || SB_command;
-    j["BrakeAcknowledge"] = brake_acknowledgeable;
-    if (valid_geo_reference) j["GeographicalPositionKM"] = valid_geo_reference->get_position(d_estfront);
-    else j["GeographicalPositionKM"]=nullptr;
-    j["TextMessages"] = messages;
-    j["DisplayTAF"] = start_display_taf && !stop_display_taf;
-    j["AllowedAck"] = ack_allowed;
-    j["ReversingPermitted"] = reversing_permitted;
-    json clock;
-    clock["Hour"] = WallClockTime::hour;
-    clock["Minute"] = WallClockTime::minute;
-    clock["Second"] = WallClockTime::second;
-    j["WallClockTime"] = clock;
-    if (display_lssma) j["LSSMA"] = lssma;
+    update_dmi();
+}
+static void fill_status(dmi_status_frame &s)
+{
+    s.flags = 0;
+    s.set(dmi_status_frame::BotDriver, bot_driver);
+    s.set(dmi_status_frame::SlipperyRail, slippery_rail_driver);
+    s.AllowedSpeed = V_perm;
+    s.InterventionSpeed = V_sbi;
+    s.TargetSpeed = V_target;
+    s.TargetDistance = D_target;
+    s.Speed = V_est;
+    s.ReleaseSpeed = V_release;
+    s.MonitoringStatus = (int)monitoring;
+    s.SupervisionStatus = (int)supervision;
+    s.Mode = (int)mode;
+    s.Level = (int)(level_valid ? level : Level::Unknown);
+    s.NTC = nid_ntc;
+    s.TimeToPermitted = TTP;
+    s.TimeToIndication = TTI;
+    s.set(dmi_status_frame::HasModeAcknowledgement, mode_acknowledgeable);
+    s.ModeAcknowledgement = (int)mode_to_ack;
+    s.set(dmi_status_frame::HasLevelTransition, ongoing_transition || level_acknowledgeable);
+    s.set(dmi_status_frame::LevelTransitionAcknowledge, level_acknowledgeable);
+    s.LevelTransitionLevel = (int)level_to_ack;
+    s.LevelTransitionNTC = ntc_to_ack;
+    s.set(dmi_status_frame::OverrideActive, overrideProcedure);
+    s.RadioStatus = (int)radio_status_driver;
+    s.set(dmi_status_frame::BrakeCommanded, EB_command || SB_command);
+    s.set(dmi_status_frame::BrakeAcknowledge, brake_acknowledgeable);
+    s.set(dmi_status_frame::HasGeographicalPosition, (bool)valid_geo_reference);
+    if (valid_geo_reference) s.GeographicalPosition = valid_geo_reference->get_position(d_estfront);
+    s.set(dmi_status_frame::DisplayTAF, start_display_taf && !stop_display_taf);
+    s.set(dmi_status_frame::AllowedAck, ack_allowed);
+    s.set(dmi_status_frame::ReversingPermitted, reversing_permitted);
+    s.Hour = WallClockTime::hour;
+    s.Minute = WallClockTime::minute;
+    s.Second = WallClockTime::second;
+    s.set(dmi_status_frame::HasLSSMA, display_lssma);
+    s.LSSMA = lssma;
+    s.SpeedTargets.clear();
+    s.GradientProfile.clear();
+    s.PlanningTrackConditions.clear();
+    s.ActiveTrackConditions.clear();
     if (mode == Mode::FS || mode == Mode::OS)
     {
-        std::vector<speed_element> speeds;
+        auto &speeds = s.SpeedTargets;
         double v = calc_ceiling_limit();
         speeds.push_back({0,v});
         auto &MRSP = get_MRSP();
@@ -349,8 +430,11 @@ void dmi_update_func()
             if (t->get_target_speed() == 0 && d<last_distance)
                 last_distance = d;
         }
-        j["IndicationMarkerTarget"] = nullptr;
-        j["IndicationMarkerDistanceM"] = nullptr;
+        auto set_indication_marker = [&s](double distance, double speed) {
+            s.set(dmi_status_frame::HasIndicationMarker, true);
+            s.IndicationMarkerTarget = {distance, speed};
+            s.IndicationMarkerDistance = indication_distance;
+        };
         double prevMRSP = 5000;
         for (auto it=MRSP.begin(); it!=MRSP.end(); ++it) {
             relocable_dist_base dist = it->first;
@@ -360,43 +444,30 @@ void dmi_update_func()
                 continue;
             if (safedist > last_distance + 1)
                 break;
-            if (indication_target != nullptr && indication_target->get_target_position() == dist && indication_target->get_target_speed() == it->second && indication_target->type == target_class::MRSP && monitoring == CSM) {
-                j["IndicationMarkerTarget"]["TargetSpeedMpS"] = indication_target->get_target_speed();
-                j["IndicationMarkerTarget"]["DistanceToTrainM"] = safedist;
-                j["IndicationMarkerDistanceM"] = indication_distance;
-            }
+            if (indication_target != nullptr && indication_target->get_target_position() == dist && indication_target->get_target_speed() == it->second && indication_target->type == target_class::MRSP && monitoring == CSM)
+                set_indication_marker(safedist, indication_target->get_target_speed());
             speeds.push_back({safedist, it->second});
         }
         if (SvL && SvL->max-d_maxsafefront(*SvL) <= last_distance + 1) {
-            if (monitoring == CSM && indication_target != nullptr && (indication_target->type == target_class::SvL || indication_target->type == target_class::EoA)){
-                j["IndicationMarkerTarget"]["TargetSpeedMpS"] = 0;
-                j["IndicationMarkerTarget"]["DistanceToTrainM"] = SvL->max-d_maxsafefront(*SvL);
-                j["IndicationMarkerDistanceM"] = indication_distance;
-            }
+            if (monitoring == CSM && indication_target != nullptr && (indication_target->type == target_class::SvL || indication_target->type == target_class::EoA))
+                set_indication_marker(SvL->max-d_maxsafefront(*SvL), 0);
             speeds.push_back({SvL->max-d_maxsafefront(*SvL), 0});
             last_distance = SvL->max-d_maxsafefront(*SvL);
         }
         else if (EoA && EoA->est-d_estfront <= last_distance + 1) {
-            if (monitoring == CSM && indication_target != nullptr && (indication_target->type == target_class::SvL || indication_target->type == target_class::EoA)) {
-                j["IndicationMarkerTarget"]["TargetSpeedMpS"] = 0;
-                j["IndicationMarkerTarget"]["DistanceToTrainM"] = EoA->est-d_estfront;
-                j["IndicationMarkerDistanceM"] = indication_distance;
-            }
+            if (monitoring == CSM && indication_target != nullptr && (indication_target->type == target_class::SvL || indication_target->type == target_class::EoA))
+                set_indication_marker(EoA->est-d_estfront, 0);
             speeds.push_back({EoA->est-d_estfront, 0});
             last_distance = EoA->est-d_estfront;
         }
         if (LoA && LoA->first.max-d_maxsafefront(LoA->first) <= last_distance + 1) {
-            if (monitoring == CSM && indication_target != nullptr && (indication_target->type == target_class::LoA)) {
-                j["IndicationMarkerTarget"]["TargetSpeedMpS"] = LoA->second;
-                j["IndicationMarkerTarget"]["DistanceToTrainM"] = LoA->first.max-d_maxsafefront(LoA->first);
-                j["IndicationMarkerDistanceM"] = indication_distance;
-            }
+            if (monitoring == CSM && indication_target != nullptr && (indication_target->type == target_class::LoA))
+                set_indication_marker(LoA->first.max-d_maxsafefront(LoA->first), LoA->second);
             speeds.push_back({LoA->first.max-d_maxsafefront(LoA->first), LoA->second});
             last_distance = LoA->first.max-d_maxsafefront(LoA->first);
         }
-        j["SpeedTargets"] = speeds;
         std::map<dist_base,double> gradient = get_gradient();
-        std::vector<gradient_element> grad;
+        auto &grad = s.GradientProfile;
         grad.push_back({0, (int)((--gradient.upper_bound(d_estfront))->second*1000)});
         for (auto it=gradient.upper_bound(d_estfront); it!=gradient.end(); ++it) {
             float dist = it->first-d_estfront;
@@ -405,7 +476,6 @@ void dmi_update_func()
             grad.push_back({dist,(int)(it->second*1000)});
         }
         grad.push_back({std::max(last_distance, 0.0),0});
-        j["GradientProfile"] = grad;
         std::vector<PlanningTrackCondition> objs;
         for (auto it = track_conditions.begin(); it != track_conditions.end(); ++it) {
             track_condition *tc = it->get();
@@ -421,7 +491,8 @@ void dmi_update_func()
             }
         }
         std::sort(objs.begin(), objs.end(), [](PlanningTrackCondition x, PlanningTrackCondition y) {return x.DistanceToTrainM < y.DistanceToTrainM;});
-        j["PlanningTrackConditions"] = objs;
+        for (auto &o : objs)
+            s.PlanningTrackConditions.push_back({o.DistanceToTrainM, (int)o.Type, (int)o.TractionSystem, o.YellowColour});
         std::set<int> active_symbols;
         for (auto it = track_conditions.begin(); it != track_conditions.end(); ++it) {
             track_condition *tc = it->get();
@@ -435,19 +506,118 @@ void dmi_update_func()
         }
         extern bool inform_lx;
         if (inform_lx) active_symbols.insert(100);
-        j["ActiveTrackConditions"] = active_symbols;
+        s.ActiveTrackConditions.assign(active_symbols.begin(), active_symbols.end());
     }
-    else
-    {
-        j["PlanningTrackConditions"] = "[]"_json;
-        j["GradientProfile"] = "[]"_json;
-        j["SpeedTargets"] = "[]"_json;
-        j["ActiveTrackConditions"] = "[]"_json;
+}
+// Rate of the kinematics channel in Hz, 0 to send it every cycle
+int dmi_kinematics_rate = 0;
+void update_dmi_kinematics()
+{
+    if (!dmi_socket)
+        return;
+    bool binary_peers = false;
+    for (auto &peer : dmi_peers) {
+        if (peer.second.protocol != dmi_protocol::Json)
+            binary_peers = true;
+    }
+    if (!binary_peers)
+        return;
+    int64_t now = get_milliseconds();
+    if (dmi_kinematics_rate > 0) {
+        static int64_t next_send;
+        if (now < next_send)
+            return;
+        int64_t period = 1000 / std::min(dmi_kinematics_rate, 50);
+        next_send = now - next_send > period ? now + period : next_send + period;
+    }
+    dmi_kinematics_frame k;
+    k.Time = (uint32_t)now;
+    k.Speed = V_est;
+    k.AllowedSpeed = V_perm;
+    k.TargetSpeed = V_target;
+    k.InterventionSpeed = V_sbi;
+    k.ReleaseSpeed = V_release;
+    k.TargetDistance = D_target;
+    k.TimeToIndication = TTI;
+    k.MonitoringStatus = (int)monitoring;
+    k.SupervisionStatus = (int)supervision;
+    k.Mode = (int)mode;
+    static std::string encoded;
+    k.encode(encoded);
+    std::string msg = "kinematics(" + encoded + ")";
+    for (auto &peer : dmi_peers) {
+        if (peer.second.protocol != dmi_protocol::Json)
+            dmi_socket->send_to(peer.first, msg);
+    }
+}
+void update_dmi()
+{
+    if (!check_dmi_socket() || !dmi_socket)
+        return;
+    sendtoor = get_milliseconds() - lastor > 250;
+    if (sendtoor) lastor = get_milliseconds();
+    static dmi_status_frame status;
+    fill_status(status);
+    bool binary_peers = false;
+    // Peers that never negotiated a protocol, and listeners whose join
+    // was not seen, only understand the JSON broadcast
+    bool json_peers = dmi_peers.empty();
+    for (auto &peer : dmi_peers) {
+        if (peer.second.protocol != dmi_protocol::Json) binary_peers = true;
+        else json_peers = true;
+    }
+    if (json_peers || sendtoor) {
+        json j = status;
+        j["TextMessages"] = messages;
+        json j2;
+        j2["Status"] = std::move(j);
+        j2["ActiveWindow"] = active_window_dmi;
+        std::string json_status = j2.dump();
+        if (json_peers)
+            send_command("json", json_status);
+        else
+            sim_write_line("noretain(etcs::dmi::command=json("+json_status+"))");
+    }
+    if (binary_peers) {
+        static std::string binary_status;
+        static std::string encoded;
+        binary_status.clear();
+        // The active window is only sent to binary peers when it changes
+        std::string window_msg;
+        if (active_window_dmi != dmi_binary_window) {
+            dmi_binary_window = active_window_dmi;
+            json window;
+            window["ActiveWindow"] = active_window_dmi;
+            window_msg = "json("+window.dump()+")";
+        }
+        for (auto &entry : dmi_peers) {
+            dmi_peer &peer = entry.second;
+            if (peer.protocol == dmi_protocol::Json)
+                continue;
+            if (!window_msg.empty())
+                dmi_socket->send_to(entry.first, window_msg);
+            if (peer.protocol == dmi_protocol::Binary) {
+                if (binary_status.empty()) {
+                    status.encode(encoded);
+                    binary_status = "status(" + encoded + ")";
+                }
+                dmi_socket->send_to(entry.first, binary_status);
+                continue;
+            }
+            uint8_t groups = dmi_status_frame::AllGroups;
+            if (peer.frames_since_keyframe >= 0 && peer.frames_since_keyframe < dmi_keyframe_period) {
+                groups = status.changed_groups(peer.last_status);
+                peer.frames_since_keyframe++;
+            } else {
+                peer.frames_since_keyframe = 0;
+            }
+            if (groups == 0)
+                continue;
+            status.encode(encoded, groups);
+            dmi_socket->send_to(entry.first, "status(" + encoded + ")");
+            peer.last_status = status;
+        }
     }
-    json j2;
-    j2["Status"] = j;
-    j2["ActiveWindow"] = active_window_dmi;
-    send_command("json", j2.dump());
     send_command("setVset", to_string(((V_set > 0 && V_set_display == -1) || V_set_display == 1) ? V_set * 3.6 : -1));
     /*
     send_command("setGeoPosition", valid_geo_reference ? to_string(valid_geo_reference->get_position(d_estfront)) : "-1");
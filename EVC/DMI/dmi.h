@@ -10,6 +10,10 @@
 #define _DMI_H
 #include <string>
 void start_dmi();
+// Sends the status to the DMI, for callers that schedule it themselves
+void update_dmi();
+// Sends the speeds to the DMIs using the binary protocol, once per cycle
+void update_dmi_kinematics();
 void send_command(std::string command, std::string value);
 void set_persistent_command(std::string command, std::string value);
 #endif
\ No newline at end of file
@@ -0,0 +1,276 @@
+/*
+ * European Train Control System
+ * Copyright (C) 2019-2023  César Benito <cesarbema2009@hotmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "status_frame.h"
+#include <cstring>
+namespace
+{
+struct frame_writer
+{
+    std::string &out;
+    template<typename T>
+    void u8(const T &v)
+    {
+        out.push_back((char)(uint8_t)v);
+    }
+    template<typename T>
+    void u16(const T &v)
+    {
+        uint16_t u = (uint16_t)v;
+        out.push_back((char)(u & 0xFF));
+        out.push_back((char)(u >> 8));
+    }
+    void i16(const int &v)
+    {
+        u16((int16_t)v);
+    }
+    void u32(uint32_t v)
+    {
+        u16(v & 0xFFFF);
+        u16(v >> 16);
+    }
+    void f32(const double &v)
+    {
+        float f = (float)v;
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        u32(u);
+    }
+    void f64(const double &v)
+    {
+        uint64_t u;
+        memcpy(&u, &v, sizeof(u));
+        u32((uint32_t)u);
+        u32((uint32_t)(u >> 32));
+    }
+    template<typename E, typename F>
+    void list(const std::vector<E> &v, F &&each)
+    {
+        u16(v.size());
+        for (auto &e : v)
+            each(e);
+    }
+};
+struct frame_reader
+{
+    std::string_view data;
+    size_t position = 0;
+    bool error = false;
+    const unsigned char *take(size_t n)
+    {
+        if (error || data.size() - position < n) {
+            error = true;
+            return nullptr;
+        }
+        const unsigned char *p = (const unsigned char*)data.data() + position;
+        position += n;
+        return p;
+    }
+    template<typename T>
+    void u8(T &v)
+    {
+        const unsigned char *p = take(1);
+        v = (T)(p ? p[0] : 0);
+    }
+    template<typename T>
+    void u16(T &v)
+    {
+        const unsigned char *p = take(2);
+        v = (T)(p ? p[0] | (p[1] << 8) : 0);
+    }
+    void i16(int &v)
+    {
+        uint16_t u;
+        u16(u);
+        v = (int16_t)u;
+    }
+    uint32_t u32()
+    {
+        uint32_t lo, hi;
+        u16(lo);
+        u16(hi);
+        return lo | (hi << 16);
+    }
+    void f32(double &v)
+    {
+        uint32_t u = u32();
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        v = f;
+    }
+    void f64(double &v)
+    {
+        uint64_t u = u32();
+        u |= (uint64_t)u32() << 32;
+        memcpy(&v, &u, sizeof(v));
+    }
+    template<typename E, typename F>
+    void list(std::vector<E> &v, F &&each)
+    {
+        size_t size;
+        u16(size);
+        v.resize(error ? 0 : size);
+        for (auto &e : v)
+            each(e);
+    }
+};
+// Visits the fields of one group in wire order, for both encoding and decoding
+template<typename Frame, typename Visitor>
+void visit_group(Frame &f, uint8_t group, Visitor &v)
+{
+    switch (group) {
+        case dmi_status_frame::Kinematics:
+            v.f32(f.AllowedSpeed);
+            v.f32(f.InterventionSpeed);
+            v.f32(f.TargetSpeed);
+            v.f32(f.TargetDistance);
+            v.f32(f.Speed);
+            v.f32(f.ReleaseSpeed);
+            v.f32(f.TimeToPermitted);
+            v.f32(f.TimeToIndication);
+            break;
+        case dmi_status_frame::State:
+            v.u16(f.flags);
+            v.u8(f.MonitoringStatus);
+            v.u8(f.SupervisionStatus);
+            v.u8(f.Mode);
+            v.u8(f.Level);
+            v.u8(f.NTC);
+            v.u8(f.ModeAcknowledgement);
+            v.u8(f.LevelTransitionLevel);
+            v.u8(f.LevelTransitionNTC);
+            v.u8(f.RadioStatus);
+            break;
+        case dmi_status_frame::Clock:
+            v.u8(f.Hour);
+            v.u8(f.Minute);
+            v.u8(f.Second);
+            break;
+        case dmi_status_frame::Position:
+            v.f64(f.GeographicalPosition);
+            v.f32(f.LSSMA);
+            v.f32(f.IndicationMarkerDistance);
+            v.f32(f.IndicationMarkerTarget.Distance);
+            v.f32(f.IndicationMarkerTarget.Speed);
+            break;
+        case dmi_status_frame::SpeedTargetsGroup:
+            v.list(f.SpeedTargets, [&v](auto &e) {
+                v.f32(e.Distance);
+                v.f32(e.Speed);
+            });
+            break;
+        case dmi_status_frame::GradientGroup:
+            v.list(f.GradientProfile, [&v](auto &e) {
+                v.f32(e.Distance);
+                v.i16(e.Gradient);
+            });
+            break;
+        case dmi_status_frame::PlanningGroup:
+            v.list(f.PlanningTrackConditions, [&v](auto &e) {
+                v.f32(e.Distance);
+                v.u8(e.Type);
+                v.u8(e.TractionSystem);
+                v.u8(e.YellowColour);
+            });
+            break;
+        case dmi_status_frame::ActiveConditionsGroup:
+            v.list(f.ActiveTrackConditions, [&v](auto &e) {
+                v.u16(e);
+            });
+            break;
+    }
+}
+}
+uint8_t dmi_status_frame::changed_groups(const dmi_status_frame &other) const
+{
+    static std::string a, b;
+    uint8_t changed = 0;
+    for (int i=0; i<8; i++) {
+        uint8_t g = 1<<i;
+        a.clear();
+        b.clear();
+        frame_writer wa{a};
+        frame_writer wb{b};
+        visit_group(*this, g, wa);
+        visit_group(other, g, wb);
+        if (a != b)
+            changed |= g;
+    }
+    return changed;
+}
+void dmi_status_frame::encode(std::string &out, uint8_t groups) const
+{
+    out.clear();
+    frame_writer w{out};
+    w.u8(DMI_STATUS_FRAME_VERSION);
+    w.u8(groups);
+    for (int i=0; i<8; i++) {
+        if (groups & (1<<i))
+            visit_group(*this, 1<<i, w);
+    }
+}
+bool dmi_status_frame::decode(std::string_view data)
+{
+    frame_reader r{data};
+    int version, groups;
+    r.u8(version);
+    r.u8(groups);
+    if (r.error || version != DMI_STATUS_FRAME_VERSION)
+        return false;
+    // Deltas are meaningless until a keyframe has been received
+    if (groups != AllGroups && !valid)
+        return false;
+    for (int i=0; i<8; i++) {
+        if (groups & (1<<i))
+            visit_group(*this, 1<<i, r);
+    }
+    if (r.error) {
+        valid = false;
+        return false;
+    }
+    updated = groups;
+    valid = true;
+    return true;
+}
+void dmi_kinematics_frame::encode(std::string &out) const
+{
+    out.clear();
+    frame_writer w{out};
+    w.u8(DMI_STATUS_FRAME_VERSION);
+    w.u32(Time);
+    w.f32(Speed);
+    w.f32(AllowedSpeed);
+    w.f32(TargetSpeed);
+    w.f32(InterventionSpeed);
+    w.f32(ReleaseSpeed);
+    w.f32(TargetDistance);
+    w.f32(TimeToIndication);
+    w.u8(MonitoringStatus);
+    w.u8(SupervisionStatus);
+    w.u8(Mode);
+}
+bool dmi_kinematics_frame::decode(std::string_view data)
+{
+    frame_reader r{data};
+    int version;
+    r.u8(version);
+    if (r.error || version != DMI_STATUS_FRAME_VERSION)
+        return false;
+    Time = r.u32();
+    r.f32(Speed);
+    r.f32(AllowedSpeed);
+    r.f32(TargetSpeed);
+    r.f32(InterventionSpeed);
+    r.f32(ReleaseSpeed);
+    r.f32(TargetDistance);
+    r.f32(TimeToIndication);
+    r.u8(MonitoringStatus);
+    r.u8(SupervisionStatus);
+    r.u8(Mode);
+    return !r.error;
+}
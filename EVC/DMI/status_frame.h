@@ -0,0 +1,135 @@
+/*
+ * European Train Control System
+ * Copyright (C) 2019-2023  César Benito <cesarbema2009@hotmail.com>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+// Status sent periodically from the EVC to the DMI.
+// It is shared by both sides so that the compact binary encoding,
+// negotiated with "protocol(binary)", does not need the JSON document.
+// With "protocol(delta)", only the groups that changed since the
+// previous frame are sent, with periodic keyframes carrying all of them.
+#define DMI_STATUS_FRAME_VERSION 2
+struct dmi_status_frame
+{
+    enum flag : uint16_t
+    {
+        BotDriver = 1<<0,
+        SlipperyRail = 1<<1,
+        OverrideActive = 1<<2,
+        BrakeCommanded = 1<<3,
+        BrakeAcknowledge = 1<<4,
+        DisplayTAF = 1<<5,
+        AllowedAck = 1<<6,
+        ReversingPermitted = 1<<7,
+        HasModeAcknowledgement = 1<<8,
+        HasLevelTransition = 1<<9,
+        LevelTransitionAcknowledge = 1<<10,
+        HasGeographicalPosition = 1<<11,
+        HasLSSMA = 1<<12,
+        HasIndicationMarker = 1<<13,
+    };
+    enum group : uint8_t
+    {
+        Kinematics = 1<<0,
+        State = 1<<1,
+        Clock = 1<<2,
+        Position = 1<<3,
+        SpeedTargetsGroup = 1<<4,
+        GradientGroup = 1<<5,
+        PlanningGroup = 1<<6,
+        ActiveConditionsGroup = 1<<7,
+        AllGroups = 0xFF,
+    };
+    struct speed_target
+    {
+        double Distance;
+        double Speed;
+    };
+    struct gradient
+    {
+        double Distance;
+        int Gradient;
+    };
+    struct track_condition
+    {
+        double Distance;
+        int Type;
+        int TractionSystem;
+        bool YellowColour;
+    };
+    uint16_t flags = 0;
+    double AllowedSpeed = 0;
+    double InterventionSpeed = 0;
+    double TargetSpeed = 0;
+    double TargetDistance = 0;
+    double Speed = 0;
+    double ReleaseSpeed = 0;
+    double TimeToPermitted = 0;
+    double TimeToIndication = 0;
+    int MonitoringStatus = 0;
+    int SupervisionStatus = 0;
+    int Mode = 0;
+    int Level = 0;
+    int NTC = 0;
+    int ModeAcknowledgement = 0;
+    int LevelTransitionLevel = 0;
+    int LevelTransitionNTC = 0;
+    int RadioStatus = 0;
+    int Hour = 0;
+    int Minute = 0;
+    int Second = 0;
+    double GeographicalPosition = 0;
+    double LSSMA = 0;
+    double IndicationMarkerDistance = 0;
+    speed_target IndicationMarkerTarget = {0, 0};
+    std::vector<speed_target> SpeedTargets;
+    std::vector<gradient> GradientProfile;
+    std::vector<track_condition> PlanningTrackConditions;
+    std::vector<int> ActiveTrackConditions;
+    // Groups present in the last decoded frame
+    uint8_t updated = 0;
+    // A keyframe has been decoded, so deltas can be applied
+    bool valid = false;
+    bool has(flag f) const
+    {
+        return (flags & f) != 0;
+    }
+    void set(flag f, bool value)
+    {
+        if (value) flags |= f;
+        else flags &= ~f;
+    }
+    // Groups whose encoding differs from the one of another frame
+    uint8_t changed_groups(const dmi_status_frame &other) const;
+    // Group mask followed by the fixed-layout groups and count-prefixed
+    // sections, little endian. Decoding patches the groups present.
+    void encode(std::string &out, uint8_t groups = AllGroups) const;
+    bool decode(std::string_view data);
+};
+// Speeds and supervision state, sent every cycle on a separate channel
+// so that the DMI does not wait for the next status frame to move the needle
+struct dmi_kinematics_frame
+{
+    // EVC time of the sample, in milliseconds
+    uint32_t Time = 0;
+    double Speed = 0;
+    double AllowedSpeed = 0;
+    double TargetSpeed = 0;
+    double InterventionSpeed = 0;
+    double ReleaseSpeed = 0;
+    double TargetDistance = 0;
+    double TimeToIndication = 0;
+    int MonitoringStatus = 0;
+    int SupervisionStatus = 0;
+    int Mode = 0;
+    void encode(std::string &out) const;
+    bool decode(std::string_view data);
+};
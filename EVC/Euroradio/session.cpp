@@ -320,7 +320,7 @@ void communication_session::update()
 
 void communication_session::setup_connection()
 {
-    #if RADIO_CFM
+    #if RADIO_CFM && !defined(EVC_REPLAY)
         connection = std::make_unique<safe_radio_connection>(this);
     #else
         connection = std::make_unique<bus_radio_connection>(this);
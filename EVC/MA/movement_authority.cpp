@@ -14,7 +14,7 @@
 #include "../TrackConditions/route_suitability.h"
 optional<relocable_dist_base> d_perturbation_eoa;
 optional<relocable_dist_base> d_perturbation_svl;
-movement_authority::movement_authority(distance start, Level1_MA ma, int64_t time) : start(start), time_stamp(time)
+movement_authority::movement_authority(distance start, const Level1_MA &ma, int64_t time) : start(start), time_stamp(time)
 {
     v_main = ma.V_MAIN.get_value();
     v_ema = ma.V_EMA.get_value();
@@ -60,7 +60,7 @@ movement_authority::movement_authority(distance start, Level1_MA ma, int64_t tim
         dp = d;
     }
 }
-movement_authority::movement_authority(distance start, Level2_3_MA ma, int64_t time) : start(start), time_stamp(time)
+movement_authority::movement_authority(distance start, const Level2_3_MA &ma, int64_t time) : start(start), time_stamp(time)
 {
     v_main = std::numeric_limits<double>::max();
     v_ema = ma.V_EMA.get_value();
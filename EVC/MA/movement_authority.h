@@ -86,8 +86,8 @@ public:
     optional<distance> SvL_ma;
     optional<std::pair<distance,double>> LoA_ma;
     float V_releaseSvL_ma;
-    movement_authority(distance start, Level1_MA ma, int64_t first_balise_passed_time);
-    movement_authority(distance start, Level2_3_MA ma, int64_t first_balise_passed_time);
+    movement_authority(distance start, const Level1_MA &ma, int64_t first_balise_passed_time);
+    movement_authority(distance start, const Level2_3_MA &ma, int64_t first_balise_passed_time);
     distance get_end()
     {
         distance end=start;
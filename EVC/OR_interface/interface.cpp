@@ -48,6 +48,35 @@ int WallClockTime::second;
 
 //std::list<euroradio_message_traintotrack> pendingmessages;
 void parse_command(string str);
+// Telegrams are decoded into this buffer, which is lent to the
+// bit_manipulator and taken back once the packets are built
+static std::vector<unsigned char> telegram_buffer;
+static void receive_telegram()
+{
+#ifdef EVC_REPLAY
+    uint64_t allocations = get_allocation_count();
+#endif
+    bit_manipulator r(std::move(telegram_buffer));
+    eurobalise_telegram t(r);
+    telegram_buffer = std::move(r.bits);
+
+    double raw_odo = odometer_value-odometer_reference;
+    if (odometer_orientation == -1) raw_odo -= L_locomotive;
+    pending_telegrams.emplace_back(std::move(t), std::make_pair(distance::from_odometer(dist_base(raw_odo, odometer_orientation)), get_milliseconds()));
+#ifdef EVC_REPLAY
+    balise_group_allocations += get_allocation_count() - allocations;
+#endif
+}
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
 void SetParameters()
 {
     ORserver::Parameter *p = new ORserver::Parameter("distance");
@@ -142,17 +171,40 @@ void SetParameters()
 
     p = new ORserver::Parameter("etcs::telegram");
     p->SetValue = [](string val) {
-        std::vector<unsigned char> message((val.size()+7)>>3);
+        telegram_buffer.assign((val.size()+7)>>3, 0);
         for (int i=0; i<val.size(); i++) {
             if (val[i]=='1')
-                message[i>>3] |= 1<<(7-(i&7));
+                telegram_buffer[i>>3] |= 1<<(7-(i&7));
         }
-        bit_manipulator r(std::move(message));
-        eurobalise_telegram t(r);
+        receive_telegram();
+    };
+    manager.AddParameter(p);
 
-        double raw_odo = odometer_value-odometer_reference;
-        if (odometer_orientation == -1) raw_odo -= L_locomotive;
-        pending_telegrams.push_back({t,{distance::from_odometer(dist_base(raw_odo, odometer_orientation)), get_milliseconds()}});
+    p = new ORserver::Parameter("etcs::telegram_base64");
+    p->SetValue = [](string val) {
+        if (base64_decode_into(val.data(), val.size(), telegram_buffer))
+            receive_telegram();
+        else
+            platform->debug_print("Invalid base64 telegram: " + val);
+    };
+    manager.AddParameter(p);
+
+    // Parameters are text lines, so raw bytes would clash with the
+    // separators. Hexadecimal is the cheapest encoding that is safe there
+    p = new ORserver::Parameter("etcs::telegram_hex");
+    p->SetValue = [](string val) {
+        bool valid = (val.size() & 1) == 0;
+        telegram_buffer.resize(val.size()>>1);
+        for (size_t i=0; valid && i<telegram_buffer.size(); i++) {
+            int hi = hex_digit(val[2*i]);
+            int lo = hex_digit(val[2*i+1]);
+            valid = hi >= 0 && lo >= 0;
+            telegram_buffer[i] = hi<<4 | lo;
+        }
+        if (valid)
+            receive_telegram();
+        else
+            platform->debug_print("Invalid hexadecimal telegram: " + val);
     };
     manager.AddParameter(p);
 
@@ -271,9 +323,13 @@ void SetParameters()
     p = new ORserver::Parameter("stm::command");
     p->SetValue = [](std::string val) {
         bit_manipulator r(val);
+        if (r.error) {
+            platform->debug_print("Invalid base64 STM message: " + val);
+            return;
+        }
         stm_message msg(r);
         handle_stm_message(msg);
-        /*for (auto &var : r.log_entries)
+        /*for (auto &var : r.get_log())
         {
             std::cout<<var.first<<"\t"<<var.second<<"\n";
         }*/
@@ -446,6 +502,8 @@ void start_or_iface()
     register_parameter("acceleration");
     register_parameter("etcs::data_entry_type");
     register_parameter("etcs::telegram");
+    register_parameter("etcs::telegram_base64");
+    register_parameter("etcs::telegram_hex");
     register_parameter("cruise_speed");
     register_parameter("etcs::set_speed_display");
     register_parameter("etcs::dmi::feedback");
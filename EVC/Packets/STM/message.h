@@ -26,6 +26,5 @@ struct stm_message : public ETCS_message
         }
         L_MESSAGE.rawdata = b.bits.size();
         b.replace(&L_MESSAGE, 8);
-        b.log_entries[1].second = std::to_string(L_MESSAGE.rawdata);
     }
 };
\ No newline at end of file
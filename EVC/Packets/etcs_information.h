@@ -38,4 +38,4 @@ struct etcs_information
     virtual ~etcs_information() {}
 };
 void handle_information_set(std::list<std::shared_ptr<etcs_information>> &ordered_info, bool from_buffer=false);
-void try_handle_information(std::shared_ptr<etcs_information> info, const std::list<std::shared_ptr<etcs_information>> &message);
\ No newline at end of file
+void try_handle_information(const std::shared_ptr<etcs_information> &info, const std::list<std::shared_ptr<etcs_information>> &message);
\ No newline at end of file
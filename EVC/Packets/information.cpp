@@ -81,7 +81,7 @@ void linking_information::handle()
 }
 void signalling_information::handle()
 {
-    Level1_MA ma = *(Level1_MA*)linked_packets.front().get();
+    auto &ma = *(Level1_MA*)linked_packets.front().get();
     if (ma.V_MAIN == 0) {
         if (!overrideProcedure && !infill) {
             trigger_condition(18);
@@ -94,7 +94,7 @@ void signalling_information::handle()
 }
 void ma_information::handle()
 {
-    Level1_MA ma = *(Level1_MA*)linked_packets.front().get();
+    auto &ma = *(Level1_MA*)linked_packets.front().get();
     movement_authority MA = movement_authority(*ref, ma, timestamp);
     if (infill)
         MA_infill(MA);
@@ -123,7 +123,7 @@ void ma_information_lv2::handle()
 {
     if (active_dialog == dialog_sequence::Main && active_dialog_step == "S7")
         active_dialog = dialog_sequence::None;
-    Level2_3_MA ma = *(Level2_3_MA*)linked_packets.front().get();
+    auto &ma = *(Level2_3_MA*)linked_packets.front().get();
     movement_authority MA = movement_authority(*ref, ma, timestamp);
     for (int i=0; i<5; i++) {
         ma_rq_reasons[i] = false;
@@ -212,12 +212,12 @@ void axle_load_speed_profile_information::handle()
 }
 void leveltr_order_information::handle()
 {
-    LevelTransitionOrder LTO = *(LevelTransitionOrder*)linked_packets.front().get();
+    auto &LTO = *(LevelTransitionOrder*)linked_packets.front().get();
     level_transition_received(level_transition_information(LTO));
 }
 void condleveltr_order_information::handle()
 {
-    ConditionalLevelTransitionOrder CLTO = *(ConditionalLevelTransitionOrder*)linked_packets.front().get();
+    auto &CLTO = *(ConditionalLevelTransitionOrder*)linked_packets.front().get();
     level_transition_received(level_transition_information(CLTO));
 }
 void session_management_information::handle()
@@ -405,7 +405,7 @@ void trip_exit_acknowledge_information::handle()
 }
 void ma_shortening_information::handle()
 {
-    Level2_3_MA ma = *(Level2_3_MA*)linked_packets.front().get();
+    auto &ma = *(Level2_3_MA*)linked_packets.front().get();
     movement_authority MA = movement_authority(*ref, ma, timestamp);
     MA.calculate_distances();
     bool accept = true;
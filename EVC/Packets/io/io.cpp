@@ -8,13 +8,202 @@
  */
 #include "../types.h"
 #include "base64.h"
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 bit_manipulator::bit_manipulator(std::string base64) : position(0)
 {
     write_mode = false;
-    std::string str = base64_decode(base64);
-    bits.insert(bits.end(), str.begin(), str.end());
+    if (!base64_decode_into(base64.data(), base64.size(), bits))
+        error = true;
+}
+// Value of each base64 character, both standard and url alphabets.
+// Invalid characters have bit 8 set
+struct base64_table
+{
+    uint32_t values[256];
+    constexpr base64_table() : values()
+    {
+        for (int i=0; i<256; i++)
+            values[i] = 0x100;
+        for (int i=0; i<26; i++) {
+            values['A'+i] = i;
+            values['a'+i] = 26+i;
+        }
+        for (int i=0; i<10; i++)
+            values['0'+i] = 52+i;
+        values['+'] = values['-'] = 62;
+        values['/'] = values['_'] = 63;
+    }
+};
+static constexpr base64_table base64_values;
+#ifdef __SSSE3__
+// Decodes blocks of 16 characters of the standard alphabet into 12 bytes,
+// as long as 16 bytes can be stored in the output. Returns the number of
+// characters decoded, the first block with other characters is left
+// for the scalar decoder
+static size_t base64_decode_ssse3(const unsigned char *in, size_t len, unsigned char *out, size_t outlen)
+{
+    // Validity of each character is found by testing the classes
+    // of its low and high nibbles against each other
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    // Offset from the character to its value, by high nibble
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2F);
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    size_t o = 0;
+    for (; i+16 <= len && o+16 <= outlen; i+=16, o+=12) {
+        __m128i str = _mm_loadu_si128((const __m128i*)(in+i));
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+        __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF)
+            break;
+        __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        str = _mm_add_epi8(str, roll);
+        // Pack the four 6 bit values of each 32 bit lane into 24 bits
+        str = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        str = _mm_madd_epi16(str, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i*)(out+o), _mm_shuffle_epi8(str, shuffle));
+    }
+    return i;
+}
+#endif
+bool base64_decode_into(const char *data, size_t len, std::vector<unsigned char> &out)
+{
+    const unsigned char *in = (const unsigned char*)data;
+    while (len > 0 && (in[len-1] == '=' || in[len-1] == '.'))
+        len--;
+    size_t rem = len & 3;
+    if (rem == 1) {
+        out.clear();
+        return false;
+    }
+    out.resize(len/4*3 + (rem ? rem-1 : 0));
+    unsigned char *o = out.data();
+    const uint32_t *t = base64_values.values;
+    uint32_t invalid = 0;
+    // Whole quartets are decoded without branches, invalid
+    // characters are only checked once at the end
+    size_t i = 0;
+#ifdef __SSSE3__
+    i = base64_decode_ssse3(in, len, o, out.size());
+    o += i/4*3;
+#endif
+    for (; i+4 <= len; i+=4, o+=3) {
+        uint32_t a = t[in[i]];
+        uint32_t b = t[in[i+1]];
+        uint32_t c = t[in[i+2]];
+        uint32_t d = t[in[i+3]];
+        invalid |= a | b | c | d;
+        uint32_t v = a<<18 | b<<12 | c<<6 | d;
+        o[0] = v>>16;
+        o[1] = v>>8;
+        o[2] = v;
+    }
+    if (rem > 0) {
+        uint32_t a = t[in[i]];
+        uint32_t b = t[in[i+1]];
+        uint32_t c = rem > 2 ? t[in[i+2]] : 0;
+        invalid |= a | b | c;
+        uint32_t v = a<<18 | b<<12 | c<<6;
+        o[0] = v>>16;
+        if (rem > 2)
+            o[1] = v>>8;
+    }
+    return (invalid & 0x100) == 0;
 }
 std::string bit_manipulator::to_base64()
 {
     return base64_encode(&bits[0], bits.size());
-}
\ No newline at end of file
+}
+std::vector<std::pair<std::string,std::string>> bit_manipulator::get_log() const
+{
+    std::vector<std::pair<std::string,std::string>> vars;
+    vars.reserve(log_entries.size());
+    for (auto &entry : log_entries) {
+        std::string name = entry.type->name();
+#ifdef _MSC_VER
+        name = name.substr(6);
+#else
+        name = name.substr(name.find_first_not_of("0123456789"));
+#endif
+        name = name.substr(0, name.size()-2);
+        vars.push_back({name, std::to_string(entry.rawdata)});
+    }
+    return vars;
+}
+#ifdef DEBUG_BIT_MANIPULATOR
+#include <limits>
+#include "../variables.h"
+#include "platform_runtime.h"
+#include <random>
+static void write_bitwise(std::vector<unsigned char> &bits, int &position, uint64_t value, int count)
+{
+    while(count-->0) {
+        bool bit = (value>>count)&1;
+        if ((position & 7) == 0)
+            bits.push_back(bit<<7);
+        else if (bit)
+            bits[position>>3] |= 1<<(7 - (position&7));
+        ++position;
+    }
+}
+static bool read_bitwise(const std::vector<unsigned char> &bits, int &position, uint64_t &value, int count)
+{
+    value = 0;
+    while(count-->0) {
+        if ((bits.size()<<3) <= position)
+            return false;
+        value = value<<1 | ((bits[position>>3]>>(7-(position&7)))&1);
+        ++position;
+    }
+    return true;
+}
+void fuzz_bit_manipulator(int iterations)
+{
+    std::mt19937_64 rng(1);
+    int failures = 0;
+    for (int it=0; it<iterations; it++) {
+        int fields = rng()%40;
+        std::vector<ETCS_variable_custom<uint64_t>> vars;
+        std::vector<unsigned char> reference;
+        int refpos = 0;
+        bit_manipulator w;
+        for (int i=0; i<fields; i++) {
+            int size = rng()%65;
+            vars.emplace_back(size);
+            vars.back().rawdata = rng();
+            w.write(&vars.back());
+            write_bitwise(reference, refpos, vars.back().rawdata, size);
+        }
+        if (w.bits != reference || w.position != refpos)
+            failures++;
+        // Drop some bytes, so that reads also run out of data
+        if (!reference.empty() && rng()%4 == 0)
+            reference.resize(rng()%reference.size());
+        std::vector<unsigned char> data = reference;
+        bit_manipulator r(std::move(data));
+        refpos = 0;
+        for (auto &var : vars) {
+            ETCS_variable_custom<uint64_t> peeked(var.size);
+            ETCS_variable_custom<uint64_t> read(var.size);
+            uint64_t value;
+            bool ok = read_bitwise(reference, refpos, value, var.size);
+            r.peek(&peeked);
+            r.read(&read);
+            if (ok != !r.error || r.position != refpos || (ok && (read.rawdata != value || peeked.rawdata != value)))
+                failures++;
+            if (!ok)
+                break;
+        }
+    }
+    platform->debug_print("bit_manipulator fuzz: " + std::to_string(iterations) + " runs, " + std::to_string(failures) + " failures");
+}
+#endif
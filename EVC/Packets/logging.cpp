@@ -9,26 +9,54 @@
 #include "logging.h"
 #include "platform_runtime.h"
 
+#include <set>
+
 std::unique_ptr<BasePlatform::BusSocket> logging_socket;
+// Peers listening on the logging bus, messages are only encoded while
+// someone is there to read them
+std::set<uint32_t> logging_subscribers;
+void logging_receive(BasePlatform::BusSocket::Message &&msg)
+{
+}
+void logging_receive(BasePlatform::BusSocket::JoinNotification &&msg)
+{
+    logging_subscribers.insert(msg.peer.uid);
+}
+void logging_receive(BasePlatform::BusSocket::LeaveNotification &&msg)
+{
+    logging_subscribers.erase(msg.peer.uid);
+}
+void logging_receive_handler(BasePlatform::BusSocket::ReceiveResult &&result)
+{
+    logging_socket->receive().then(logging_receive_handler).detach();
+    std::visit([](auto&& arg){ logging_receive(std::move(arg)); }, std::move(result));
+}
 void start_logging()
 {
+    logging_subscribers.clear();
     logging_socket = platform->open_socket("evc_logging", BasePlatform::BusSocket::PeerId::fourcc("EVC"));
+    if (logging_socket)
+        logging_socket->receive().then(logging_receive_handler).detach();
 }
-void print_vars(std::string &str, std::vector<std::pair<std::string,std::string>> vars)
+void print_vars(std::string &str, const std::vector<std::pair<std::string,std::string>> &vars)
 {
     for (auto &var : vars)
     {
         str += var.first + '\t' + var.second + '\n';
     }
 }
-void log_message(ETCS_message &msg, dist_base &dist, int64_t time)
+void log_message(ETCS_message &msg, const dist_base &dist, int64_t time)
 {
-    if (!logging_socket)
+    bool subscribed = logging_socket && !logging_subscribers.empty();
+#ifndef DEBUG_TRACK_MESSAGES
+    if (!subscribed)
         return;
+#endif
     bit_manipulator b;
+    b.logging = true;
     msg.write_to(b);
     std::string str = "Distance: " + std::to_string(dist.dist+odometer_reference) + "\t Time: " + std::to_string(time) + "\n";
-    print_vars(str, b.log_entries);
+    print_vars(str, b.get_log());
     if (b.error)
         str += "Read error\n";
     else if (b.sparefound)
@@ -36,5 +64,6 @@ void log_message(ETCS_message &msg, dist_base &dist, int64_t time)
 #ifdef DEBUG_TRACK_MESSAGES
     platform->debug_print(str);
 #endif
-    logging_socket->broadcast(str);
+    if (subscribed)
+        logging_socket->broadcast(str);
 }
@@ -11,4 +11,4 @@
 #include "../Time/clock.h"
 #include "messages.h"
 void start_logging();
-void log_message(ETCS_message &msg, dist_base &dist, int64_t time);
\ No newline at end of file
+void log_message(ETCS_message &msg, const dist_base &dist, int64_t time);
\ No newline at end of file
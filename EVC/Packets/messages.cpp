@@ -35,6 +35,7 @@
 #include "../Version/version.h"
 #include "../Version/translate.h"
 #include <algorithm>
+#include <array>
 #include "platform_runtime.h"
 static int reading_nid_bg=-1;
 static int reading_nid_c=-1;
@@ -63,14 +64,19 @@ static bool linking_available;
 std::deque<std::pair<eurobalise_telegram, std::pair<distance,int64_t>>> pending_telegrams;
 optional<link_data> rams_reposition_mitigation;
 void trigger_reaction(int reaction);
-void handle_telegrams(std::vector<eurobalise_telegram> message, dist_base dist, int dir, int64_t timestamp, bg_id nid_bg, bool linked, int m_version);
+void handle_telegrams(const std::vector<eurobalise_telegram> &message, dist_base dist, int dir, int64_t timestamp, bg_id nid_bg, bool linked, int m_version);
 void handle_radio_message(std::shared_ptr<euroradio_message> message);
-void check_valid_data(std::vector<eurobalise_telegram> telegrams, dist_base bg_reference, bool linked, int64_t timestamp);
+void check_valid_data(const std::vector<eurobalise_telegram> &telegrams, dist_base bg_reference, bool linked, int64_t timestamp);
 void update_track_comm();
 void balise_group_passed();
 void check_linking();
 void expect_next_linking();
 std::vector<etcs_information*> construct_information(ETCS_packet *packet, euroradio_message *msg);
+#ifdef EVC_REPLAY
+uint64_t balise_group_allocations;
+// Allocation count when the balise pipeline last started charging the group
+static uint64_t balise_group_mark;
+#endif
 void trigger_reaction(int reaction)
 {
     switch (reaction) {
@@ -95,6 +101,9 @@ void reset_eurobalise_data()
     prevpig = -1;
     totalbg = 8;
     reading = false;
+#ifdef EVC_REPLAY
+    balise_group_allocations = 0;
+#endif
     dir = -1;
     orientation = -1;
     refmissed = false;
@@ -209,8 +218,8 @@ void balise_group_passed()
         }
         if (l.nid_bg.NID_BG == 16383) {
             bool repositioning = false;
-            for (auto tel : telegrams) {
-                for (auto pack : tel.packets) {
+            for (auto &tel : telegrams) {
+                for (auto &pack : tel.packets) {
                     if (pack->NID_PACKET == 16) {
                         auto &Q_DIR = ((ETCS_directional_packet*)pack.get())->Q_DIR;
                         if (Q_DIR == Q_DIR.Both || (Q_DIR == Q_DIR.Nominal && dir == 0) || (Q_DIR == Q_DIR.Reverse && dir == 1)) {
@@ -238,8 +247,8 @@ void balise_group_passed()
         }
         if (rams_reposition_mitigation) {
             bool repositioning = false;
-            for (auto tel : telegrams) {
-                for (auto pack : tel.packets) {
+            for (auto &tel : telegrams) {
+                for (auto &pack : tel.packets) {
                     if (pack->NID_PACKET == 16) {
                         auto& Q_DIR = ((ETCS_directional_packet*)pack.get())->Q_DIR;
                         if (Q_DIR == Q_DIR.Both || (Q_DIR == Q_DIR.Nominal && dir == 0) || (Q_DIR == Q_DIR.Reverse && dir == 1)) {
@@ -264,36 +273,38 @@ void balise_group_passed()
         }
     }
     if (!linking_rejected) check_valid_data(telegrams, bg_reference.est, linked, first_balise_time);
+#ifdef EVC_REPLAY
+    record_balise_group_allocations(telegrams.size(), balise_group_allocations + get_allocation_count() - balise_group_mark);
+#endif
     reset_eurobalise_data();
+#ifdef EVC_REPLAY
+    balise_group_mark = get_allocation_count();
+#endif
 }
 void update_track_comm()
 {
     update_radio();
     update_vbc();
-    if (pending_telegrams.empty()) {
-        check_linking();
-        if (reading) {
-            double elapsed = d_estfront_dir[odometer_orientation == -1]-L_antenna_front-last_passed_distance.est;
-            if (elapsed > 12)
-                balise_group_passed();
-        }
-    } else {
-        eurobalise_telegram t = pending_telegrams.front().first;
-        distance passed_dist = pending_telegrams.front().second.first-L_antenna_front;
-        log_message(t, passed_dist.est, pending_telegrams.front().second.second);
+    extern optional<distance> rmp_position;
+#ifdef EVC_REPLAY
+    balise_group_mark = get_allocation_count();
+#endif
+    // Telegrams are drained in order until a balise group is complete,
+    // the remaining ones are left for the next cycle
+    while (!pending_telegrams.empty()) {
+        auto pending = std::move(pending_telegrams.front());
         pending_telegrams.pop_front();
-        extern optional<distance> rmp_position;
+        eurobalise_telegram &t = pending.first;
+        distance passed_dist = pending.second.first-L_antenna_front;
+        // Every received telegram is recorded, also those rejected below
+        log_message(t, passed_dist.est, pending.second.second);
         int rev = ((mode == Mode::PT || mode == Mode::RV) ? -1 : 1);
-        if (rmp_position && (rmp_position->est - d_estfront)*rev > 0.1) {
-            update_track_comm();
-            return;
-        }
+        if (rmp_position && (rmp_position->est - d_estfront)*rev > 0.1)
+            continue;
         if (!t.readerror) {
             int m_version = t.M_VERSION;
-            if (VERSION_X(m_version) == 0) {
-                update_track_comm();
-                return;
-            }
+            if (VERSION_X(m_version) == 0)
+                continue;
             bool higherver = true;
             for (int ver : supported_versions) {
                 if (VERSION_X(ver) >= VERSION_X(m_version))
@@ -302,11 +313,10 @@ void update_track_comm()
             if (higherver) {
                 if (mode != Mode::RV)
                     trigger_condition(65);
-                update_track_comm();
-                return;
+                continue;
             }
             bool ignored = false;
-            for (auto p : t.packets) {
+            for (auto &p : t.packets) {
                 if (p->NID_PACKET == 0 || p->NID_PACKET == 200) {
                     auto *vbc = (VirtualBaliseCoverMarker*)p.get();
                     if (vbc_ignored(t.NID_C, vbc->NID_VBCMK))
@@ -315,10 +325,8 @@ void update_track_comm()
                     break;
                 }
             }
-            if (ignored) {
-                update_track_comm();
-                return;
-            }
+            if (ignored)
+                continue;
         }
         distance prev_distance = last_passed_distance;
         last_passed_distance = passed_dist;
@@ -359,12 +367,12 @@ void update_track_comm()
                 check_linking();
             }
             if ((dir==0 && t.N_PIG == t.N_TOTAL) || (dir == 1 && t.N_PIG == 0) || (t.N_PIG == 0 && t.N_TOTAL == 0)) {
-                telegrams.push_back(t);
+                telegrams.push_back(std::move(t));
                 balise_group_passed();
                 return;
             }
         }
-        telegrams.push_back(t);
+        telegrams.push_back(std::move(t));
         if (refmissed && dupfound) {
             bg_reference = bg_reference1;
             bg_referencemax = bg_reference1max;
@@ -372,10 +380,19 @@ void update_track_comm()
             refpassed = true;
             check_linking();
         }
-        update_track_comm();
     }
+    check_linking();
+    if (reading) {
+        double elapsed = d_estfront_dir[odometer_orientation == -1]-L_antenna_front-last_passed_distance.est;
+        if (elapsed > 12)
+            balise_group_passed();
+    }
+#ifdef EVC_REPLAY
+    if (reading)
+        balise_group_allocations += get_allocation_count() - balise_group_mark;
+#endif
 }
-void check_valid_data(std::vector<eurobalise_telegram> telegrams, dist_base bg_reference, bool linked, int64_t timestamp)
+void check_valid_data(const std::vector<eurobalise_telegram> &telegrams, dist_base bg_reference, bool linked, int64_t timestamp)
 {
     int nid_bg=-1;
     int nid_c=-1;
@@ -386,7 +403,7 @@ void check_valid_data(std::vector<eurobalise_telegram> telegrams, dist_base bg_r
     int n_total=-1;
     std::vector<eurobalise_telegram> read_telegrams;
     for (int i=0; i<telegrams.size(); i++) {
-        eurobalise_telegram t = telegrams[i];
+        const eurobalise_telegram &t = telegrams[i];
         if (!t.readerror) {
             m_version = t.M_VERSION;
             nid_bg = t.NID_BG;
@@ -440,7 +457,7 @@ void check_valid_data(std::vector<eurobalise_telegram> telegrams, dist_base bg_r
         for (int pig=0; pig<=n_total; pig++) {
             bool reject=true;
             for (int i=0; i<read_telegrams.size() && reject; i++) {
-                eurobalise_telegram t = read_telegrams[i];
+                const eurobalise_telegram &t = read_telegrams[i];
                 if (t.N_PIG == pig) {
                     reject = false;
                 } else if ((t.M_DUP == t.M_DUP.DuplicateOfNext && t.N_PIG+1==pig) || (t.M_DUP == t.M_DUP.DuplicateOfPrev && t.N_PIG==pig+1)) {
@@ -470,15 +487,15 @@ void check_valid_data(std::vector<eurobalise_telegram> telegrams, dist_base bg_r
 
     std::vector<eurobalise_telegram> message;
     for (int i=0; i<read_telegrams.size(); i++) {
-        eurobalise_telegram t = read_telegrams[i];
+        const eurobalise_telegram &t = read_telegrams[i];
         bool c1 = t.M_DUP == t.M_DUP.NoDuplicates;
         bool c2 = t.M_DUP == t.M_DUP.DuplicateOfNext && i+1<read_telegrams.size() && t.N_PIG+1==read_telegrams[i+1].N_PIG;
         bool c3 = t.M_DUP == t.M_DUP.DuplicateOfPrev && i>1 && t.N_PIG==read_telegrams[i-1].N_PIG+1;
         if (c1 || !(c2||c3))
             message.push_back(t);
         if ((c2 && passed_dir==0) || (c3 && passed_dir==1)) {
-            eurobalise_telegram first = t;
-            eurobalise_telegram second = c2 ? read_telegrams[i+1] : read_telegrams[i-1];
+            const eurobalise_telegram &first = t;
+            const eurobalise_telegram &second = c2 ? read_telegrams[i+1] : read_telegrams[i-1];
             bool firstdefault = false;
             for (int j=0; j<first.packets.size(); j++) {
                 if (first.packets[j]->NID_PACKET == 254) {
@@ -537,7 +554,7 @@ void check_valid_data(std::vector<eurobalise_telegram> telegrams, dist_base bg_r
         } else {
             if (accepted2) {
                 for (int i=0; i<message.size(); i++) {
-                    eurobalise_telegram t = message[i];
+                    const eurobalise_telegram &t = message[i];
                     if (t.packets.empty())
                         continue;
                     for (int j=0; j<t.packets.size()-1; j++) {
@@ -651,7 +668,7 @@ void handle_information_set(std::list<std::shared_ptr<etcs_information>> &ordere
     if (transition_buffer.size() > 3)
         transition_buffer.pop_front();
 }
-void handle_telegrams(std::vector<eurobalise_telegram> message, dist_base dist, int dir, int64_t timestamp, bg_id nid_bg, bool linked, int m_version)
+void handle_telegrams(const std::vector<eurobalise_telegram> &message, dist_base dist, int dir, int64_t timestamp, bg_id nid_bg, bool linked, int m_version)
 {
     if (NV_NID_Cs.find(nid_bg.NID_C) == NV_NID_Cs.end()) {
         reset_national_values();
@@ -667,7 +684,7 @@ void handle_telegrams(std::vector<eurobalise_telegram> message, dist_base dist,
 
     std::list<std::shared_ptr<etcs_information>> ordered_info;
     for (int i=0; i<message.size(); i++) {
-        eurobalise_telegram t = message[i];
+        const eurobalise_telegram &t = message[i];
         optional<bg_id> infill;
         for (int j=0; j<t.packets.size(); j++) {
             ETCS_packet *p = t.packets[j].get();
@@ -682,7 +699,7 @@ void handle_telegrams(std::vector<eurobalise_telegram> message, dist_base dist,
                 }
             }
             if (p->NID_PACKET == 136) {
-                InfillLocationReference ilr = *((InfillLocationReference*)p);
+                auto &ilr = *((InfillLocationReference*)p);
                 infill = bg_id({ilr.Q_NEWCOUNTRY == ilr.Q_NEWCOUNTRY.SameCountry ? nid_bg.NID_C : ilr.NID_C, (int)ilr.NID_BG});
             } else if (p->NID_PACKET == 80 || p->NID_PACKET == 49 || p->NID_PACKET == 181) {
                 for (auto it = ordered_info.rbegin(); it!=ordered_info.rend(); ++it) {
@@ -866,7 +883,7 @@ bool handle_radio_message(std::shared_ptr<euroradio_message> message, communicat
             }
         }
         if (p->NID_PACKET == 136) {
-            InfillLocationReference ilr = *((InfillLocationReference*)p);
+            auto &ilr = *((InfillLocationReference*)p);
             infill = bg_id({ilr.Q_NEWCOUNTRY == ilr.Q_NEWCOUNTRY.SameCountry ? lrbg.NID_C : ilr.NID_C, (int)ilr.NID_BG});
         } else if (p->NID_PACKET == 80) {
             for (auto it = ordered_info.rbegin(); it!=ordered_info.rend(); ++it) {
@@ -920,57 +937,157 @@ bool handle_radio_message(std::shared_ptr<euroradio_message> message, communicat
     handle_information_set(ordered_info);
     return true;
 }
-struct level_filter_data
+// Condition of the filter tables: accepted (A) or rejected (R),
+// with the numbered exceptions stored as a bitmask
+struct accepted_condition
 {
-    int num;
-    Level level;
-    bool fromRBC;
-    bool operator<(const level_filter_data &o) const
+    bool reject;
+    uint32_t exceptions;
+    bool has_exception(int num) const
     {
-        if (num==o.num) {
-            if (level == o.level)
-                return fromRBC<o.fromRBC;
-            return level<o.level;
-        }
-        return num<o.num;
+        return (exceptions>>num) & 1;
     }
 };
-struct accepted_condition
+static constexpr accepted_condition parse_condition(const char *str)
 {
-    bool reject;
-    std::set<int> exceptions;
+    accepted_condition c = {false, 0};
+    if (str[0] == 0 || (str[0] == 'N' && str[1] == 'R'))
+        return c;
+    c.reject = str[0] == 'R';
+    int num = -1;
+    for (const char *ch = str+1;; ch++) {
+        if (*ch >= '0' && *ch <= '9') {
+            num = (num < 0 ? 0 : num*10) + (*ch-'0');
+        } else {
+            if (num >= 0)
+                c.exceptions |= 1u<<num;
+            num = -1;
+            if (*ch == 0)
+                break;
+        }
+    }
+    return c;
+}
+static constexpr const char *level_filter_conditions[][10] = {
+    {"A","A","A","A","A","R2","R2","R2","A","A"},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"R1","R1","A","R1","R1","","","","",""},
+    {"R1","R1","A4","R1","R1","R2","R2","R2","A3,4,5","A3,4,5"},
+    {"R","R","A","R","R","","","","",""},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"A","A","A","A","A","A","A","A","A","A"},
+    {"A11","A11","A11","A11","A11","","","","",""},
+    {"A","A","A","A14","A14","A","A","A","A","A"},
+    {"A","A","A","A","A","A","A","A","A","A"},
+    {"","","","","","A","A","A","A","A"},
+    {"","","","","","A","A","A","A","A"},
+    {"","","","","","R","R","R","A3","A3"},
+    {"R","R","A","A","A","","","","",""},
+    {"R","R","A","R","R","","","","",""},
+    {"A","R1,2","A","A8","A8","R2","R2","R2","A3","A3"},
+    {"A","R1,2","A","A","A","R2","R2","R2","A3","A3"},
+    {"","","","","","R2","R2","R2","A","A"},
+    {"A","R1,2","A","A","A","","","","",""},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"R1","R1","A","R","R","R2","R2","R2","A","A"},
+    {"A","R1,2","A","A","A","R2","R2","R2","A12","A12"},
+    {"A","R1,2","A","A","A","R2","R2","R2","A12","A12"},
+    {"A","R1,2","A","A","A","R2","R2","R2","A","A"},
+    {"R","R","R","A","A","R","R","R","A3","A3"},
+    {"A13","A13","A","A","A","","","","",""},
+    {"A","A","A","A","A","","","","",""},
+    {"R","R","A","R1","R1","","","","",""},
+    {"R","R","A","R","R","","","","",""},
+    {"A","A","A","A","A","","","","",""},
+    {"","","","","","A10","A10","A10","A10","A10"},
+    {"R","R","A","R1","R1","","","","",""},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"A","A","A","A","A","","","","",""},
+    {"A","A","A","A","A","","","","",""},
+    {"","","","","","R","R","R","A","A"},
+    {"","","","","","A","A","A","A","A"},
+    {"","","","","","R","R","R","A3,4,5","A3,4,5"},
+    {"","","","","","R2","R2","R2","A","A"},
+    {"","","","","","R2","R2","R2","A","A"},
+    {"","","","","","R","R","R","A","A"},
+    {"","","","","","R","R","R","A3","A3"},
+    {"","","","","","R","R","R","A3","A3"},
+    {"A","A","A","A","A","A","A","A","A","A"},
+    {"A","A","A","A","A","","","","",""},
+    {"","","","","","R","R","R","A3","A3"},
+    {"","","","","","R","R","R","A","A"},
+    {"A","A","A","A","A","A","A","A","A","A"},
+    {"A","A","A","A","A","","","","",""},
+    {"","","","","","R","R","R","A","A"},
+    {"","","","","","R","R","R","A","A"},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"A","A","A","A","A","","","","",""},
+    {"A9","A9","A9","R","R","","","","",""},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
+    {"R1,2","R1,2","A","A","A","R2","R2","R2","A3","A3"},
+    {"A","A","A","A","A","","","","",""},
+    {"A","A","A","A","A","","","","",""},
+    {"R1","R1","A","R1","R1","R2","R2","R2","A3,5","A3,5"},
+    {"R","R","A","R","R","R","R","R","A","A"},
+    {"A","A","A","A","A","A","A","A","A","A"}
 };
-std::map<level_filter_data, accepted_condition> level_filter_index;
-bool level_filter(std::shared_ptr<etcs_information> info, const std::list<std::shared_ptr<etcs_information>> &message) 
+static constexpr int level_count = (int)Level::Unknown+1;
+static constexpr int level_filter_count = sizeof(level_filter_conditions)/sizeof(level_filter_conditions[0]);
+typedef std::array<std::array<std::array<accepted_condition, 2>, level_count>, level_filter_count> level_filter_table;
+static constexpr level_filter_table build_level_filter()
+{
+    Level levels[] = {Level::N0, Level::NTC, Level::N1, Level::N2, Level::N3};
+    level_filter_table table {};
+    for (int i=0; i<level_filter_count; i++) {
+        for (int j=0; j<10; j++) {
+            table[i][(int)levels[j%5]][j>4] = parse_condition(level_filter_conditions[i][j]);
+        }
+    }
+    return table;
+}
+static constexpr level_filter_table level_filter_index = build_level_filter();
+static accepted_condition get_level_condition(int num, Level lv, bool fromRBC)
+{
+    if (num < 0 || num >= level_filter_count)
+        return {false, 0};
+    return level_filter_index[num][(int)lv][fromRBC];
+}
+// End of the MA including overlap or danger point, as in
+// movement_authority::get_abs_end(), read from the packet directly
+template<typename T>
+static dist_base get_ma_abs_end(dist_base end, const T &ma)
+{
+    for (unsigned i=0; i<ma.N_ITER; i++)
+        end += ma.sections[i].L_SECTION.get_value(ma.Q_SCALE);
+    end += ma.L_ENDSECTION.get_value(ma.Q_SCALE);
+    if (ma.Q_OVERLAP)
+        end += ma.D_OL.get_value(ma.Q_SCALE);
+    else if (ma.Q_DANGERPOINT)
+        end += ma.D_DP.get_value(ma.Q_SCALE);
+    return end;
+}
+bool level_filter(const std::shared_ptr<etcs_information> &info, const std::list<std::shared_ptr<etcs_information>> &message) 
 {
     if (info->infill && ((level != Level::N1 && (!ongoing_transition || ongoing_transition->leveldata.level != Level::N1 || (level != Level::N2 && level != Level::N3))) || (mode != Mode::FS && mode != Mode::LS)))
         return false;
-    accepted_condition s = level_filter_index[{info->index_level, level, info->fromRBC != nullptr}];
+    accepted_condition s = get_level_condition(info->index_level, level, info->fromRBC != nullptr);
     if (!s.reject && info->infill)
     {
-        accepted_condition s2 = level_filter_index[{32, level, info->fromRBC != nullptr}];
+        accepted_condition s2 = get_level_condition(32, level, info->fromRBC != nullptr);
         if (s2.reject) s = s2;
     }
     if (!s.reject) {
-        if (s.exceptions.find(3) != s.exceptions.end()) {
+        if (s.has_exception(3)) {
             if (supervising_rbc && supervising_rbc->train_data_ack_pending)
                 return false;
         }
-        if (s.exceptions.find(4) != s.exceptions.end()) {
-            if (info->linked_packets.begin()->get()->NID_PACKET == 12) {
-                Level1_MA ma = *((Level1_MA*)info->linked_packets.begin()->get());
-                movement_authority MA = movement_authority(*info->ref, ma, info->timestamp);
-                dist_base end = MA.get_abs_end().max;
-                dist_base ssp_start = SSP_begin();
-                dist_base ssp_end = SSP_end();
-                if (ssp_end<end || ssp_start > d_estfront)
-                    return false;
-                if (get_gradient().empty() || (--get_gradient().end())->first<end || get_gradient().begin()->first > d_estfront)
-                    return false;   
-            } else if (info->linked_packets.begin()->get()->NID_PACKET == 15) {
-                Level2_3_MA ma = *((Level2_3_MA*)info->linked_packets.begin()->get());
-                movement_authority MA = movement_authority(*info->ref, ma, info->timestamp);
-                dist_base end = MA.get_abs_end().max;
+        if (s.has_exception(4)) {
+            ETCS_packet *packet = info->linked_packets.begin()->get();
+            if (packet->NID_PACKET == 12 || packet->NID_PACKET == 15) {
+                dist_base end = packet->NID_PACKET == 12 ? get_ma_abs_end(info->ref->max, *(Level1_MA*)packet) : get_ma_abs_end(info->ref->max, *(Level2_3_MA*)packet);
                 dist_base ssp_start = SSP_begin();
                 dist_base ssp_end = SSP_end();
                 if (ssp_end<end || ssp_start > d_estfront)
@@ -979,19 +1096,19 @@ bool level_filter(std::shared_ptr<etcs_information> info, const std::list<std::s
                     return false;   
             }
         }
-        if (s.exceptions.find(5) != s.exceptions.end()) {
+        if (s.has_exception(5)) {
             if (!emergency_stops.empty())
                 return false;
         }
-        if (s.exceptions.find(8) != s.exceptions.end()) {
-            TemporarySpeedRestriction tsr = *((TemporarySpeedRestriction*)info->linked_packets.begin()->get());
+        if (s.has_exception(8)) {
+            auto &tsr = *((TemporarySpeedRestriction*)info->linked_packets.begin()->get());
             if(tsr.NID_TSR != tsr.NID_TSR.NonRevocable && inhibit_revocable_tsr) return false;
         }
-        if (s.exceptions.find(9) != s.exceptions.end()) {
+        if (s.has_exception(9)) {
             if (!ongoing_transition || (ongoing_transition->leveldata.level != Level::N2 && ongoing_transition->leveldata.level != Level::N3))
                 return false;
         }
-        if (s.exceptions.find(10) != s.exceptions.end()) {
+        if (s.has_exception(10)) {
             auto &msg = *((coordinate_system_assignment*)info->message->get());
             if (info->fromRBC != nullptr) {
                 auto it = info->fromRBC->prvlrbgs.find(msg.NID_LRBG.get_value());
@@ -999,24 +1116,24 @@ bool level_filter(std::shared_ptr<etcs_information> info, const std::list<std::s
                     return false;
             }
         }
-        if (s.exceptions.find(11) != s.exceptions.end()) {
+        if (s.has_exception(11)) {
             if (ongoing_transition)
                 return false;
-            for (auto m : message) {
+            for (auto &m : message) {
                 if (m->index_level == 8)
                     return false;
             }
         }
-        if (s.exceptions.find(13) != s.exceptions.end()) {
+        if (s.has_exception(13)) {
             bool ltr_order_received = false;
-            for (auto m : message) {
+            for (auto &m : message) {
                 if (m->index_level == 8) {
-                    LevelTransitionOrder LTO = *(LevelTransitionOrder*)m->linked_packets.front().get();
+                    auto &LTO = *(LevelTransitionOrder*)m->linked_packets.front().get();
                     Level lv = level_transition_information(LTO).leveldata.level;
                     if (lv == Level::N1 || lv == Level::N2 || level == Level::N3)
                         ltr_order_received = true;
                 } else if (m->index_level == 9) {
-                    ConditionalLevelTransitionOrder CLTO = *(ConditionalLevelTransitionOrder*)m->linked_packets.front().get();
+                    auto &CLTO = *(ConditionalLevelTransitionOrder*)m->linked_packets.front().get();
                     Level lv = level_transition_information(CLTO).leveldata.level;
                     if (lv == Level::N1 || lv == Level::N2 || level == Level::N3)
                         ltr_order_received = true;
@@ -1025,15 +1142,15 @@ bool level_filter(std::shared_ptr<etcs_information> info, const std::list<std::s
             if (!ltr_order_received)
                 return false;
         }
-        if (s.exceptions.find(14) != s.exceptions.end()) {
+        if (s.has_exception(14)) {
             SessionManagement &session = *(SessionManagement*)info->linked_packets.front().get();
             contact_info info = {session.NID_C, session.NID_RBC, session.NID_RADIO};
             if (session.Q_RBC == session.Q_RBC.EstablishSession) {
                 if (accepting_rbc && accepting_rbc->contact == info)
                     return false;
-                for (auto m : message) {
+                for (auto &m : message) {
                     if (m->index_level == 16) {
-                        RBCTransitionOrder o = *(RBCTransitionOrder*)m->linked_packets.front().get();
+                        auto &o = *(RBCTransitionOrder*)m->linked_packets.front().get();
                         contact_info info2 = {o.NID_C, o.NID_RBC, o.NID_RADIO};
                         if (info2 == info)
                             return false;
@@ -1044,12 +1161,12 @@ bool level_filter(std::shared_ptr<etcs_information> info, const std::list<std::s
         }
         return true;
     } else {
-        if (s.exceptions.find(1) != s.exceptions.end()) {
+        if (s.has_exception(1)) {
             if (ongoing_transition && ongoing_transition->leveldata.level == Level::N1)
                 transition_buffer.back().push_back(info);
             return false;
         }
-        if (s.exceptions.find(2) != s.exceptions.end()) {
+        if (s.has_exception(2)) {
             if (ongoing_transition && (ongoing_transition->leveldata.level == Level::N2 || ongoing_transition->leveldata.level == Level::N3))
                 transition_buffer.back().push_back(info);
             return false;
@@ -1058,205 +1175,7 @@ bool level_filter(std::shared_ptr<etcs_information> info, const std::list<std::s
     }
     return false;
 }
-void set_level_filter()
-{
-    std::vector<std::vector<std::string>> conds = {
-        {"A","A","A","A","A","R2","R2","R2","A","A"},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"R1","R1","A","R1","R1","","","","",""},
-        {"R1","R1","A4","R1","R1","R2","R2","R2","A3,4,5","A3,4,5"},
-        {"R","R","A","R","R","","","","",""},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"A","A","A","A","A","A","A","A","A","A"},
-        {"A11","A11","A11","A11","A11","","","","",""},
-        {"A","A","A","A14","A14","A","A","A","A","A"},
-        {"A","A","A","A","A","A","A","A","A","A"},
-        {"","","","","","A","A","A","A","A"},
-        {"","","","","","A","A","A","A","A"},
-        {"","","","","","R","R","R","A3","A3"},
-        {"R","R","A","A","A","","","","",""},
-        {"R","R","A","R","R","","","","",""},
-        {"A","R1,2","A","A8","A8","R2","R2","R2","A3","A3"},
-        {"A","R1,2","A","A","A","R2","R2","R2","A3","A3"},
-        {"","","","","","R2","R2","R2","A","A"},
-        {"A","R1,2","A","A","A","","","","",""},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"R1","R1","A","R","R","R2","R2","R2","A","A"},
-        {"A","R1,2","A","A","A","R2","R2","R2","A12","A12"},
-        {"A","R1,2","A","A","A","R2","R2","R2","A12","A12"},
-        {"A","R1,2","A","A","A","R2","R2","R2","A","A"},
-        {"R","R","R","A","A","R","R","R","A3","A3"},
-        {"A13","A13","A","A","A","","","","",""},
-        {"A","A","A","A","A","","","","",""},
-        {"R","R","A","R1","R1","","","","",""},
-        {"R","R","A","R","R","","","","",""},
-        {"A","A","A","A","A","","","","",""},
-        {"","","","","","A10","A10","A10","A10","A10"},
-        {"R","R","A","R1","R1","","","","",""},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"A","A","A","A","A","","","","",""},
-        {"A","A","A","A","A","","","","",""},
-        {"","","","","","R","R","R","A","A"},
-        {"","","","","","A","A","A","A","A"},
-        {"","","","","","R","R","R","A3,4,5","A3,4,5"},
-        {"","","","","","R2","R2","R2","A","A"},
-        {"","","","","","R2","R2","R2","A","A"},
-        {"","","","","","R","R","R","A","A"},
-        {"","","","","","R","R","R","A3","A3"},
-        {"","","","","","R","R","R","A3","A3"},
-        {"A","A","A","A","A","A","A","A","A","A"},
-        {"A","A","A","A","A","","","","",""},
-        {"","","","","","R","R","R","A3","A3"},
-        {"","","","","","R","R","R","A","A"},
-        {"A","A","A","A","A","A","A","A","A","A"},
-        {"A","A","A","A","A","","","","",""},
-        {"","","","","","R","R","R","A","A"},
-        {"","","","","","R","R","R","A","A"},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"A","A","A","A","A","","","","",""},
-        {"A9","A9","A9","R","R","","","","",""},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3","A3"},
-        {"R1,2","R1,2","A","A","A","R2","R2","R2","A3","A3"},
-        {"A","A","A","A","A","","","","",""},
-        {"A","A","A","A","A","","","","",""},
-        {"R1","R1","A","R1","R1","R2","R2","R2","A3,5","A3,5"},
-        {"R","R","A","R","R","R","R","R","A","A"},
-        {"A","A","A","A","A","A","A","A","A","A"}
-    };
-    Level levels[] = {Level::N0, Level::NTC, Level::N1, Level::N2, Level::N3};
-    for (int i=0; i<conds.size(); i++) {
-        for (int j=0; j<10; j++) {
-            std::string str = conds[i][j];
-            if (str != "") {
-                bool rej = str[0] == 'R';
-                str = str.substr(1);
-                std::set<int> except;
-                for(;!str.empty();) {
-                    std::size_t index = str.find_first_of(',');
-                    except.insert(std::stoi(str.substr(0, index)));
-                    if (index != std::string::npos)
-                        str = str.substr(index+1);
-                    else
-                        break;
-                }
-                level_filter_index[{i, levels[j%5], j>4}] = {rej, except};
-            }
-        }
-    }
-}
-struct mode_filter_data
-{
-    int num;
-    Mode mode;
-    bool operator<(const mode_filter_data &o) const
-    {
-        if (num==o.num) {
-            return mode<o.mode;
-        }
-        return num<o.num;
-    }
-};
-std::map<mode_filter_data, accepted_condition> mode_filter_index;
-void set_mode_filter()
-{
-    std::vector<std::vector<std::string>> conds = {
-        {"NR","A2","A","A","A","A","A","A","A","A","A","A","A1","NR","NR","A","A"},
-        {"NR","A2,4","R","R","A","A","A","A","R","A","A","R","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","R","R","R","A","A","R","A","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","R","R"},
-        {"NR","A2","A7","A7","A","A","A","A","A","A","A","A","A1,5","NR","NR","A","R"},
-        {"NR","A","A3","A3","A","A","A","A","A","A","A","A","A1","NR","NR","A","A"},
-        {"NR","A2","A","A","A","A","A","A","A","A","A","A","A1","NR","NR","A","A"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2","R","R","A","A","A","A","R","A","A","R","A1","NR","NR","A","A"},
-        {"NR","A2,4","R","R","R","R","A","R","R","R","R","R","A1","NR","NR","R","R"},
-        {"NR","R","R","R","R","R","A","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","R","R","R","R","R","A6","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","A"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","A"},
-        {"NR","A2","R","R","A","A","A","A","R","A","A","A","A1","NR","NR","A","R"},
-        {"NR","A2,4","A8","A8","A","A","A","A","A","A","R","A","A1","NR","NR","R","R"},
-        {"NR","R","R","A","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","R","A","R","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","R","R","R","A","A","A","A", "R", "R", "R", "R", "R","NR","NR","R","R"},
-        {"NR","R","R","R","A","A","A","A", "R", "R", "R", "R", "R","NR","NR","R","R"},
-        {"NR","R","R","A","A","A","A","A","A","A","A","A","R","NR","NR","A","A"},
-        {"NR","A2","R","R","R","R","A","R","R","A","A","R","A1","NR","NR","A","R"},
-        {"NR","R","R","R","A","A","R","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","A","A","A","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2,4","A","A","A","A","A","A","A","A","A","A","A1","NR","NR","A","R"},
-        {"NR","A2","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
-        {"NR","R","R","R","R","R","R","R","R","R","R","R","A","NR","NR","R","R"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","A","A","NR","NR","A","A"},
-        {"NR","R","R","R","A","A","R","A","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","R","R","NR","NR","A","R"},
-        {"NR","R","R","R","A","A","R","A","R","R","A","R","R","NR","NR","A","R"},
-        {"NR","R","R","R","A","A","R","A","R","R","R","R","A1","NR","NR","R","R"},
-        {"NR","A2","R","R","A","A","A","A","R","R","R","R","A1","NR","NR","R","R"},
-        {"NR","A2","R","R","A","A","A","A","R","R","R","R","A1","NR","NR","R","R"},
-        {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
-        {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
-        {"NR","A2","R","R","R","A","A","A","R","R","R","R","A1","NR","NR","R","R"},
-        {"NR","A2","R","R","A","A","A","A","R","A","R","A","A","NR","NR","R","A"},
-        {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
-        {"NR","A2","R","R","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","A2","R","R","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","A2","R","R","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","A"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","A"},
-        {"NR","A2","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
-        {"NR","A2","R","R","A","A","A","A","R","R","A","A","A","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
-        {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
-        {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
-        {"NR","R","R","R","A9","A","A9","A9","R","R","A9","R","R","NR","NR","A9","R"},
-        {"NR","R","R","R","R","A","R","R","R","R","R","R","R","NR","NR","R","R"},
-        {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"}
-    };
-    Mode modes[] = {Mode::NP, Mode::SB, Mode::PS, Mode::SH, Mode::FS, Mode::LS, Mode::SR, Mode::OS, Mode::SL, Mode::NL, Mode::UN, Mode::TR, Mode::PT, Mode::SF, Mode::IS, Mode::SN, Mode::RV};
-    for (int i=0; i<conds.size(); i++) {
-        for (int j=0; j<17; j++) {
-            std::string str = conds[i][j];
-            if (str != "" && str != "NR") {
-                bool rej = str[0] == 'R';
-                str = str.substr(1);
-                std::set<int> except;
-                for(;!str.empty();) {
-                    std::size_t index = str.find_first_of(',');
-                    except.insert(std::stoi(str.substr(0, index)));
-                    if (index != std::string::npos)
-                        str = str.substr(index+1);
-                    else
-                        break;
-                }
-                mode_filter_index[{i, modes[j]}] = {rej, except};
-            }
-        }
-    }
-}
-void set_message_filters()
-{
-    set_mode_filter();
-    set_level_filter();
-}
-bool second_filter(std::shared_ptr<etcs_information> info, const std::list<std::shared_ptr<etcs_information>> &message)
+bool second_filter(const std::shared_ptr<etcs_information> &info, const std::list<std::shared_ptr<etcs_information>> &message)
 {
     if (!info->fromRBC || info->fromRBC == supervising_rbc)
         return true;
@@ -1269,24 +1188,117 @@ bool second_filter(std::shared_ptr<etcs_information> info, const std::list<std::
     transition_buffer.back().push_back(info);
     return false;
 }
-bool mode_filter(std::shared_ptr<etcs_information> info, const std::list<std::shared_ptr<etcs_information>> &message)
+static constexpr const char *mode_filter_conditions[][17] = {
+    {"NR","A2","A","A","A","A","A","A","A","A","A","A","A1","NR","NR","A","A"},
+    {"NR","A2,4","R","R","A","A","A","A","R","A","A","R","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","R","R","R","A","A","R","A","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","R","R"},
+    {"NR","A2","A7","A7","A","A","A","A","A","A","A","A","A1,5","NR","NR","A","R"},
+    {"NR","A","A3","A3","A","A","A","A","A","A","A","A","A1","NR","NR","A","A"},
+    {"NR","A2","A","A","A","A","A","A","A","A","A","A","A1","NR","NR","A","A"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2","R","R","A","A","A","A","R","A","A","R","A1","NR","NR","A","A"},
+    {"NR","A2,4","R","R","R","R","A","R","R","R","R","R","A1","NR","NR","R","R"},
+    {"NR","R","R","R","R","R","A","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","R","R","R","R","R","A6","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","A"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","A","A1","NR","NR","A","A"},
+    {"NR","A2","R","R","A","A","A","A","R","A","A","A","A1","NR","NR","A","R"},
+    {"NR","A2,4","A8","A8","A","A","A","A","A","A","R","A","A1","NR","NR","R","R"},
+    {"NR","R","R","A","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","R","A","R","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","R","R","R","A","A","A","A", "R", "R", "R", "R", "R","NR","NR","R","R"},
+    {"NR","R","R","R","A","A","A","A", "R", "R", "R", "R", "R","NR","NR","R","R"},
+    {"NR","R","R","A","A","A","A","A","A","A","A","A","R","NR","NR","A","A"},
+    {"NR","A2","R","R","R","R","A","R","R","A","A","R","A1","NR","NR","A","R"},
+    {"NR","R","R","R","A","A","R","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","A","A","A","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2,4","A","A","A","A","A","A","A","A","A","A","A1","NR","NR","A","R"},
+    {"NR","A2","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
+    {"NR","R","R","R","R","R","R","R","R","R","R","R","A","NR","NR","R","R"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","A","A","NR","NR","A","A"},
+    {"NR","R","R","R","A","A","R","A","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","R","R","NR","NR","A","R"},
+    {"NR","R","R","R","A","A","R","A","R","R","A","R","R","NR","NR","A","R"},
+    {"NR","R","R","R","A","A","R","A","R","R","R","R","A1","NR","NR","R","R"},
+    {"NR","A2","R","R","A","A","A","A","R","R","R","R","A1","NR","NR","R","R"},
+    {"NR","A2","R","R","A","A","A","A","R","R","R","R","A1","NR","NR","R","R"},
+    {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
+    {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
+    {"NR","A2","R","R","R","A","A","A","R","R","R","R","A1","NR","NR","R","R"},
+    {"NR","A2","R","R","A","A","A","A","R","A","R","A","A","NR","NR","R","A"},
+    {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
+    {"NR","A2","R","R","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","A2","R","R","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","A2","R","R","R","R","R","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","A"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","A"},
+    {"NR","A2","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
+    {"NR","A2","R","R","A","A","A","A","R","R","A","A","A","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A2,4","R","R","A","A","A","A","R","R","A","R","A1","NR","NR","A","R"},
+    {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
+    {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"},
+    {"NR","R","R","R","A9","A","A9","A9","R","R","A9","R","R","NR","NR","A9","R"},
+    {"NR","R","R","R","R","A","R","R","R","R","R","R","R","NR","NR","R","R"},
+    {"NR","A","A","A","A","A","A","A","A","A","A","A","A","NR","NR","A","A"}
+};
+#if BASELINE == 4
+static constexpr int mode_count = (int)Mode::SM+1;
+#else
+static constexpr int mode_count = (int)Mode::RV+1;
+#endif
+static constexpr int mode_filter_count = sizeof(mode_filter_conditions)/sizeof(mode_filter_conditions[0]);
+typedef std::array<std::array<accepted_condition, mode_count>, mode_filter_count> mode_filter_table;
+static constexpr mode_filter_table build_mode_filter()
+{
+    Mode modes[] = {Mode::NP, Mode::SB, Mode::PS, Mode::SH, Mode::FS, Mode::LS, Mode::SR, Mode::OS, Mode::SL, Mode::NL, Mode::UN, Mode::TR, Mode::PT, Mode::SF, Mode::IS, Mode::SN, Mode::RV};
+    mode_filter_table table {};
+    for (int i=0; i<mode_filter_count; i++) {
+        for (int j=0; j<17; j++) {
+            table[i][(int)modes[j]] = parse_condition(mode_filter_conditions[i][j]);
+        }
+    }
+    return table;
+}
+static constexpr mode_filter_table mode_filter_index = build_mode_filter();
+static accepted_condition get_mode_condition(int num, Mode m)
+{
+    if (num < 0 || num >= mode_filter_count)
+        return {false, 0};
+    return mode_filter_index[num][(int)m];
+}
+bool mode_filter(const std::shared_ptr<etcs_information> &info, const std::list<std::shared_ptr<etcs_information>> &message)
 {
     if (info->infill && mode != Mode::FS && mode != Mode::LS)
         return false;
-    accepted_condition s = mode_filter_index[{info->index_mode, mode}];
+    accepted_condition s = get_mode_condition(info->index_mode, mode);
     if (s.reject) {
         return false;
     } else {
-        if (s.exceptions.find(1) != s.exceptions.end()) {
+        if (s.has_exception(1)) {
             if (level == Level::N1 || !trip_exit_acknowledged || info->timestamp < trip_exit_acknowledge_timestamp) return false;
         }
-        if (s.exceptions.find(2) != s.exceptions.end()) {
+        if (s.has_exception(2)) {
             if (!cab_active[0] && !cab_active[1]) return false;
         }
-        if (s.exceptions.find(4) != s.exceptions.end()) {
+        if (s.has_exception(4)) {
             if (!train_data_valid) return false;
         }
-        if (s.exceptions.find(5) != s.exceptions.end()) {
+        if (s.has_exception(5)) {
             if (info->index_level == 8) {
                 LevelTransitionOrder &LTO = *(LevelTransitionOrder*)info->linked_packets.front().get();
                 if (LTO.D_LEVELTR == LTO.D_LEVELTR.Now) return false;
@@ -1294,24 +1306,24 @@ bool mode_filter(std::shared_ptr<etcs_information> info, const std::list<std::sh
             if (info->index_level == 9)
                 return false;
         }
-        if (s.exceptions.find(6) != s.exceptions.end()) {
+        if (s.has_exception(6)) {
             if (overrideProcedure) return false;
         }
-        if (s.exceptions.find(7) != s.exceptions.end()) {
+        if (s.has_exception(7)) {
             if (info->index_level == 8) {
                 LevelTransitionOrder &LTO = *(LevelTransitionOrder*)info->linked_packets.front().get();
                 if (LTO.D_LEVELTR != LTO.D_LEVELTR.Now) return false;
             }
         }
-        if (s.exceptions.find(8) != s.exceptions.end()) {
+        if (s.has_exception(8)) {
             if (info->index_level == 10) {
                 RBCTransitionOrder &o = *(RBCTransitionOrder*)info->linked_packets.front().get();
                 if (o.D_RBCTR != 0) return false;
             }
         }
-        if (s.exceptions.find(9) != s.exceptions.end()) {
+        if (s.has_exception(9)) {
             bool inside_ls = false;
-            for (auto i : message) {
+            for (auto &i : message) {
                 if (i->index_mode == 3 && i->ref) {
                     for (auto it = ++i->linked_packets.begin(); it != i->linked_packets.end(); ++it) {
                         if (it->get()->NID_PACKET == 80) {
@@ -1336,7 +1348,7 @@ bool mode_filter(std::shared_ptr<etcs_information> info, const std::list<std::sh
         return true;
     }
 }
-void try_handle_information(std::shared_ptr<etcs_information> info, const std::list<std::shared_ptr<etcs_information>> &message)
+void try_handle_information(const std::shared_ptr<etcs_information> &info, const std::list<std::shared_ptr<etcs_information>> &message)
 {
     if (info->location_based && !info->ref) return;
     if (!level_filter(info, message)) return;
@@ -1344,108 +1356,3 @@ void try_handle_information(std::shared_ptr<etcs_information> info, const std::l
     if (!mode_filter(info, message)) return;
     info->handle();
 }
-std::vector<etcs_information*> construct_information(ETCS_packet *packet, euroradio_message *msg)
-{
-    int packet_num = packet->NID_PACKET.rawdata;
-    std::vector<etcs_information*> info;
-    if (packet_num == 2) {
-        info.push_back(new version_order_information());
-    } else if (packet_num == 3) {
-        auto nvi = new national_values_information();
-        auto *nv = (NationalValues*)packet;
-        nvi->location_based = nv->D_VALIDNV != nv->D_VALIDNV.Now;
-        info.push_back(nvi);
-    } else if (packet_num == 5) {
-        info.push_back(new linking_information());
-    } else if (packet_num == 6) {
-        info.push_back(new vbc_order());
-    } else if (packet_num == 12) {
-        info.push_back(new ma_information());
-        info.push_back(new signalling_information());
-    } else if (packet_num == 15) {
-        if (msg != nullptr && msg->NID_MESSAGE == 9)
-            info.push_back(new ma_shortening_information());
-        else
-            info.push_back(new ma_information_lv2());
-    } else if (packet_num == 16) {
-        info.push_back(new repositioning_information());
-    } else if (packet_num == 21) {
-        info.push_back(new gradient_information());
-    } else if (packet_num == 27) {
-        info.push_back(new issp_information());
-    } else if (packet_num == 39) {
-        info.push_back(new track_condition_information());
-    } else if (packet_num == 40) {
-        info.push_back(new track_condition_information());
-    } else if (packet_num == 41) {
-        info.push_back(new leveltr_order_information());
-    } else if (packet_num == 42) {
-        info.push_back(new session_management_information());
-    } else if (packet_num == 46) {
-        info.push_back(new condleveltr_order_information());
-    } else if (packet_num == 51) {
-        info.push_back(new axle_load_speed_profile_information());
-    } else if (packet_num == 52) {
-        info.push_back(new pbd_information());
-    } else if (packet_num == 57) {
-        info.push_back(new ma_request_params_info());
-    } else if (packet_num == 58) {
-        auto *prp = new position_report_params_info();
-        prp->location_based = ((PositionReportParameters*)packet)->N_ITER > 0;
-        info.push_back(prp);
-    } else if (packet_num == 65) {
-        info.push_back(new TSR_information());
-    } else if (packet_num == 66) {
-        info.push_back(new TSR_revocation_information());
-    } else if (packet_num == 67) {
-        info.push_back(new track_condition_big_metal_information());
-    } else if (packet_num == 68) {
-        info.push_back(new track_condition_information());
-        info.push_back(new track_condition_information2());
-    } else if (packet_num == 69) {
-        info.push_back(new track_condition_information());
-    } else if (packet_num == 70) {
-        info.push_back(new route_suitability_information());
-    } else if (packet_num == 72) {
-        auto pti = new plain_text_information();
-        PlainTextMessage *m = (PlainTextMessage*)packet;
-        pti->location_based = m->D_TEXTDISPLAY != m->D_TEXTDISPLAY.NotDistanceLimited;
-        info.push_back(pti);
-    } else if (packet_num == 76) {
-        auto fti = new fixed_text_information();
-        FixedTextMessage *m = (FixedTextMessage*)packet;
-        fti->location_based = m->D_TEXTDISPLAY != m->D_TEXTDISPLAY.NotDistanceLimited;
-        info.push_back(fti);
-    } else if (packet_num == 79) {
-        info.push_back(new geographical_position_information());
-    } else if (packet_num == 88) {
-        info.push_back(new level_crossing_information());
-    } else if (packet_num == 90) {
-        info.push_back(new taf_level23_information());
-    } else if (packet_num == 131) {
-        info.push_back(new rbc_transition_information());
-    } else if (packet_num == 132) {
-        info.push_back(new danger_for_SH_information());
-    } else if (packet_num == 137) {
-        info.push_back(new stop_if_in_SR_information());
-    } else if (packet_num == 138) {
-        info.push_back(new reversing_area_information());
-    } else if (packet_num == 139) {
-        info.push_back(new reversing_supervision_information());
-    } else if (packet_num == 140) {
-        info.push_back(new train_running_number_information());
-    } else if (packet_num == 141) {
-        info.push_back(new TSR_gradient_information());
-    } else if (packet_num == 180) {
-        auto *order = (LSSMAToggleOrder*)packet;
-        if (order->Q_LSSMA == order->Q_LSSMA.ToggleOff)
-            info.push_back(new lssma_display_off_information());
-        else
-            info.push_back(new lssma_display_on_information());
-    } else if (packet_num == 181) {
-        info.push_back(new generic_ls_marker_information());
-    } else if (packet_num == 254) {
-        info.push_back(new default_balise_information());
-    }
-    return info;
-}
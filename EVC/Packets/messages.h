@@ -47,13 +47,14 @@ struct eurobalise_telegram : public ETCS_message
         NID_C.copy(b);
         NID_BG.copy(b);
         Q_LINK.copy(b);
+        auto arena = std::make_shared<packet_arena>(packet_arena::measure(b, M_VERSION));
         while (!b.error)
         {
             NID_PACKET_t NID_PACKET;
             b.peek(&NID_PACKET);
             if (NID_PACKET==255)
                 break;
-            packets.push_back(std::shared_ptr<ETCS_packet>(ETCS_packet::construct(b, M_VERSION)));
+            packets.push_back(ETCS_packet::construct(b, M_VERSION, arena));
         }
         readerror = b.error;
         valid = !b.sparefound;
@@ -81,5 +82,11 @@ struct eurobalise_telegram : public ETCS_message
 extern std::deque<std::pair<eurobalise_telegram, std::pair<distance,int64_t>>> pending_telegrams;
 extern std::list<link_data>::iterator link_expected;
 void update_track_comm();
+#ifdef EVC_REPLAY
+// Allocations of the process, counted by evc_replay. Decoding, filtering
+// and handling telegrams are charged to the balise group being read
+uint64_t get_allocation_count();
+void record_balise_group_allocations(size_t telegrams, uint64_t allocations);
+extern uint64_t balise_group_allocations;
+#endif
 bool handle_radio_message(std::shared_ptr<euroradio_message> msg, communication_session *session);
-void set_message_filters();
\ No newline at end of file
@@ -64,85 +64,187 @@
 #include "V1/200.h"
 #include "V1/203.h"
 #include "254.h"
-ETCS_packet *ETCS_packet::construct(bit_manipulator &r, int m_version)
+#include "radio.h"
+#include "information.h"
+#include <array>
+#include <type_traits>
+// Version families a packet definition is decoded for
+enum packet_family
+{
+    UnknownVersion = 1,
+    Version1 = 2,
+    Version2 = 4,
+    NotVersion1 = UnknownVersion | Version2,
+    AnyVersion = UnknownVersion | Version1 | Version2,
+};
+typedef ETCS_packet *(*packet_factory)(packet_arena *arena);
+struct packet_type
+{
+    packet_factory create;
+    size_t size;
+    bool directional;
+};
+typedef void (*information_builder)(ETCS_packet *packet, euroradio_message *msg, std::vector<etcs_information*> &info);
+struct packet_registration
+{
+    int nid_packet;
+    int families;
+    packet_type type;
+    information_builder information;
+};
+template<typename T>
+static ETCS_packet *create_packet(packet_arena *arena)
+{
+    return arena != nullptr ? arena->create<T>() : new T();
+}
+template<typename T>
+static constexpr packet_type packet_of()
+{
+    return {create_packet<T>, sizeof(T), std::is_base_of<ETCS_directional_packet, T>::value};
+}
+template<typename... I>
+static void build_information(ETCS_packet *packet, euroradio_message *msg, std::vector<etcs_information*> &info)
+{
+    (info.push_back(new I()), ...);
+}
+static void national_values_builder(ETCS_packet *packet, euroradio_message *msg, std::vector<etcs_information*> &info)
+{
+    auto nvi = new national_values_information();
+    auto *nv = (NationalValues*)packet;
+    nvi->location_based = nv->D_VALIDNV != nv->D_VALIDNV.Now;
+    info.push_back(nvi);
+}
+static void level2_ma_builder(ETCS_packet *packet, euroradio_message *msg, std::vector<etcs_information*> &info)
+{
+    if (msg != nullptr && msg->NID_MESSAGE == 9)
+        info.push_back(new ma_shortening_information());
+    else
+        info.push_back(new ma_information_lv2());
+}
+static void position_report_params_builder(ETCS_packet *packet, euroradio_message *msg, std::vector<etcs_information*> &info)
+{
+    auto *prp = new position_report_params_info();
+    prp->location_based = ((PositionReportParameters*)packet)->N_ITER > 0;
+    info.push_back(prp);
+}
+static void plain_text_builder(ETCS_packet *packet, euroradio_message *msg, std::vector<etcs_information*> &info)
+{
+    auto pti = new plain_text_information();
+    PlainTextMessage *m = (PlainTextMessage*)packet;
+    pti->location_based = m->D_TEXTDISPLAY != m->D_TEXTDISPLAY.NotDistanceLimited;
+    info.push_back(pti);
+}
+static void fixed_text_builder(ETCS_packet *packet, euroradio_message *msg, std::vector<etcs_information*> &info)
+{
+    auto fti = new fixed_text_information();
+    FixedTextMessage *m = (FixedTextMessage*)packet;
+    fti->location_based = m->D_TEXTDISPLAY != m->D_TEXTDISPLAY.NotDistanceLimited;
+    info.push_back(fti);
+}
+static void lssma_toggle_builder(ETCS_packet *packet, euroradio_message *msg, std::vector<etcs_information*> &info)
+{
+    auto *order = (LSSMAToggleOrder*)packet;
+    if (order->Q_LSSMA == order->Q_LSSMA.ToggleOff)
+        info.push_back(new lssma_display_off_information());
+    else
+        info.push_back(new lssma_display_on_information());
+}
+// Every packet known to the EVC. Information is built from packets
+// already translated to the current version, so it only depends on NID_PACKET
+static constexpr packet_registration registrations[] = {
+    {0, Version2, packet_of<VirtualBaliseCoverMarker>(), nullptr},
+    {2, AnyVersion, packet_of<SystemVersionOrder>(), build_information<version_order_information>},
+    {3, Version1, packet_of<V1::NationalValues>(), nullptr},
+    {3, NotVersion1, packet_of<NationalValues>(), national_values_builder},
+    {5, AnyVersion, packet_of<Linking>(), build_information<linking_information>},
+    {6, AnyVersion, packet_of<VirtualBaliseCoverOrder>(), build_information<vbc_order>},
+    {12, AnyVersion, packet_of<Level1_MA>(), build_information<ma_information, signalling_information>},
+    {15, 0, {}, level2_ma_builder},
+    {16, AnyVersion, packet_of<RepositioningInformation>(), build_information<repositioning_information>},
+    {21, AnyVersion, packet_of<GradientProfile>(), build_information<gradient_information>},
+    {27, Version1, packet_of<V1::InternationalSSP>(), nullptr},
+    {27, NotVersion1, packet_of<InternationalSSP>(), build_information<issp_information>},
+    {39, Version1, packet_of<V1::TrackConditionChangeTractionSystem>(), nullptr},
+    {39, NotVersion1, packet_of<TrackConditionChangeTractionSystem>(), build_information<track_condition_information>},
+    {40, Version2, packet_of<TrackConditionChangeCurrentConsumption>(), build_information<track_condition_information>},
+    {41, AnyVersion, packet_of<LevelTransitionOrder>(), build_information<leveltr_order_information>},
+    {42, AnyVersion, packet_of<SessionManagement>(), build_information<session_management_information>},
+    {45, AnyVersion, packet_of<RadioNetworkRegistration>(), nullptr},
+    {46, AnyVersion, packet_of<ConditionalLevelTransitionOrder>(), build_information<condleveltr_order_information>},
+    {49, AnyVersion, packet_of<ListSHBalises>(), nullptr},
+    {51, AnyVersion, packet_of<AxleLoadSpeedProfile>(), build_information<axle_load_speed_profile_information>},
+    {52, Version2, packet_of<PermittedBrakingDistanceInformation>(), build_information<pbd_information>},
+    {57, AnyVersion, packet_of<MovementAuthorityRequestParameters>(), build_information<ma_request_params_info>},
+    {58, AnyVersion, packet_of<PositionReportParameters>(), position_report_params_builder},
+    {63, AnyVersion, packet_of<ListSRBalises>(), nullptr},
+    {64, Version2, packet_of<InhibitionOfRevocableTSRL23>(), nullptr},
+    {65, AnyVersion, packet_of<TemporarySpeedRestriction>(), build_information<TSR_information>},
+    {66, AnyVersion, packet_of<TemporarySpeedRestrictionRevocation>(), build_information<TSR_revocation_information>},
+    {67, AnyVersion, packet_of<TrackConditionBigMetalMasses>(), build_information<track_condition_big_metal_information>},
+    {68, AnyVersion, packet_of<TrackCondition>(), build_information<track_condition_information, track_condition_information2>},
+    {69, Version2, packet_of<TrackConditionStationPlatforms>(), build_information<track_condition_information>},
+    {70, AnyVersion, packet_of<RouteSuitabilityData>(), build_information<route_suitability_information>},
+    {71, AnyVersion, packet_of<AdhesionFactor>(), nullptr},
+    {72, Version1, packet_of<V1::PlainTextMessage>(), nullptr},
+    {72, NotVersion1, packet_of<PlainTextMessage>(), plain_text_builder},
+    {76, Version2, packet_of<FixedTextMessage>(), fixed_text_builder},
+    {79, Version1, packet_of<V1::GeographicalPosition>(), nullptr},
+    {79, NotVersion1, packet_of<GeographicalPosition>(), build_information<geographical_position_information>},
+    {80, Version1, packet_of<V1::ModeProfile>(), nullptr},
+    {80, NotVersion1, packet_of<ModeProfile>(), nullptr},
+    {88, Version2, packet_of<LevelCrossingInformation>(), build_information<level_crossing_information>},
+    {90, AnyVersion, packet_of<TrackAheadFreeTransition>(), build_information<taf_level23_information>},
+    {131, AnyVersion, packet_of<RBCTransitionOrder>(), build_information<rbc_transition_information>},
+    {132, AnyVersion, packet_of<DangerForShunting>(), build_information<danger_for_SH_information>},
+    {133, AnyVersion, packet_of<RadioInfillAreaInformation>(), nullptr},
+    {136, AnyVersion, packet_of<InfillLocationReference>(), nullptr},
+    {137, AnyVersion, packet_of<StopIfInSR>(), build_information<stop_if_in_SR_information>},
+    {138, AnyVersion, packet_of<ReversingAreaInformation>(), build_information<reversing_area_information>},
+    {139, AnyVersion, packet_of<ReversingSupervisionInformation>(), build_information<reversing_supervision_information>},
+    {140, AnyVersion, packet_of<TrainRunningNumberRBC>(), build_information<train_running_number_information>},
+    {141, AnyVersion, packet_of<DefaultGradientTSR>(), build_information<TSR_gradient_information>},
+    {143, Version2, packet_of<SessionManagementNeighbourRIU>(), nullptr},
+    {180, Version2, packet_of<LSSMAToggleOrder>(), lssma_toggle_builder},
+    {181, Version2, packet_of<GenericLSFunctionMarker>(), build_information<generic_ls_marker_information>},
+    {200, Version1, packet_of<V1::VirtualBaliseCoverMarker>(), nullptr},
+    {203, Version1, packet_of<V1::NationalValuesBraking>(), nullptr},
+    {206, Version1, packet_of<TrackCondition>(), nullptr},
+    {239, Version1, packet_of<TrackConditionChangeTractionSystem>(), nullptr},
+    {254, AnyVersion, packet_of<DefaultBaliseInformation>(), build_information<default_balise_information>},
+};
+struct packet_table_entry
+{
+    packet_type type[3] = {};
+    information_builder information = nullptr;
+};
+static constexpr std::array<packet_table_entry, 256> build_packet_table()
+{
+    std::array<packet_table_entry, 256> table {};
+    for (auto &r : registrations) {
+        for (int f=0; f<3; f++) {
+            if (r.families & (1<<f))
+                table[r.nid_packet].type[f] = r.type;
+        }
+        if (r.information != nullptr)
+            table[r.nid_packet].information = r.information;
+    }
+    return table;
+}
+static constexpr std::array<packet_table_entry, 256> packet_table = build_packet_table();
+static int packet_family_index(int m_version)
+{
+    int x = VERSION_X(m_version);
+    return x == 1 ? 1 : (x > 1 ? 2 : 0);
+}
+ETCS_packet *ETCS_packet::construct(bit_manipulator &r, int m_version, packet_arena *arena)
 {
     int pos = r.position;
     NID_PACKET_t NID_PACKET;
     r.peek(&NID_PACKET);
     ETCS_packet *p = nullptr;
-    switch ((unsigned char)NID_PACKET) {
-        case 0: if (VERSION_X(m_version) > 1) p = new VirtualBaliseCoverMarker(); break;
-        case 2: p = new SystemVersionOrder(); break;
-        case 3:
-            if (VERSION_X(m_version) == 1) p = new V1::NationalValues();
-            else p = new NationalValues();
-            break;
-        case 5: p = new Linking(); break;
-        case 6: p = new VirtualBaliseCoverOrder(); break;
-        case 12: p = new Level1_MA(); break;
-        case 16: p = new RepositioningInformation(); break;
-        case 21: p = new GradientProfile(); break;
-        case 27:
-            if (VERSION_X(m_version) == 1) p = new V1::InternationalSSP();
-            else p = new InternationalSSP();
-            break;
-        case 39:
-            if (VERSION_X(m_version) == 1) p = new V1::TrackConditionChangeTractionSystem();
-            else p = new TrackConditionChangeTractionSystem();
-            break;
-        case 40: if (VERSION_X(m_version) > 1) p = new TrackConditionChangeCurrentConsumption(); break;
-        case 41: p = new LevelTransitionOrder(); break;
-        case 42: p = new SessionManagement(); break;
-        case 45: p = new RadioNetworkRegistration(); break;
-        case 46: p = new ConditionalLevelTransitionOrder(); break;
-        case 49: p = new ListSHBalises(); break;
-        case 51: p = new AxleLoadSpeedProfile(); break;
-        case 52: if (VERSION_X(m_version) > 1)p = new PermittedBrakingDistanceInformation(); break;
-        case 57: p = new MovementAuthorityRequestParameters(); break;
-        case 58: p = new PositionReportParameters(); break;
-        case 63: p = new ListSRBalises(); break;
-        case 64: if (VERSION_X(m_version) > 1) p = new InhibitionOfRevocableTSRL23(); break;
-        case 65: p = new TemporarySpeedRestriction(); break;
-        case 66: p = new TemporarySpeedRestrictionRevocation(); break;
-        case 67: p = new TrackConditionBigMetalMasses(); break;
-        case 68: p = new TrackCondition(); break;
-        case 69: if (VERSION_X(m_version) > 1) p = new TrackConditionStationPlatforms(); break;
-        case 70: p = new RouteSuitabilityData(); break;
-        case 71: p = new AdhesionFactor(); break;
-        case 72:
-            if (VERSION_X(m_version) == 1) p = new V1::PlainTextMessage();
-            else p = new PlainTextMessage();
-            break;
-        case 76: if (VERSION_X(m_version) > 1) p = new FixedTextMessage(); break;
-        case 79:
-            if (VERSION_X(m_version) == 1) p = new V1::GeographicalPosition();
-            else p = new GeographicalPosition();
-            break;
-        case 80:
-            if (VERSION_X(m_version) == 1) p = new V1::ModeProfile();
-            else p = new ModeProfile();
-            break;
-        case 88: if (VERSION_X(m_version) > 1) p = new LevelCrossingInformation(); break;
-        case 90: p = new TrackAheadFreeTransition(); break;
-        case 131: p = new RBCTransitionOrder(); break;
-        case 132: p = new DangerForShunting(); break;
-        case 133: p = new RadioInfillAreaInformation(); break;
-        case 136: p = new InfillLocationReference(); break;
-        case 137: p = new StopIfInSR(); break;
-        case 138: p = new ReversingAreaInformation(); break;
-        case 139: p = new ReversingSupervisionInformation(); break;
-        case 140: p = new TrainRunningNumberRBC(); break;
-        case 141: p = new DefaultGradientTSR(); break;
-        case 143: if (VERSION_X(m_version) > 1) p = new SessionManagementNeighbourRIU(); break;
-        case 180: if (VERSION_X(m_version) > 1) p = new LSSMAToggleOrder(); break;
-        case 181: if (VERSION_X(m_version) > 1) p = new GenericLSFunctionMarker(); break;
-        case 200: if (VERSION_X(m_version) == 1) p = new V1::VirtualBaliseCoverMarker(); break;
-        case 203: if (VERSION_X(m_version) == 1) p = new V1::NationalValuesBraking(); break;
-        case 206: if (VERSION_X(m_version) == 1) p = new TrackCondition(); break;
-        case 239: if (VERSION_X(m_version) == 1) p = new TrackConditionChangeTractionSystem(); break;
-        case 254: p = new DefaultBaliseInformation(); break;
-        default: break;
-    }
+    packet_factory create = packet_table[(unsigned char)NID_PACKET].type[packet_family_index(m_version)].create;
+    if (create != nullptr)
+        p = create(arena);
     if (p == nullptr) {
         bool highery = false;
         for (int v : supported_versions) {
@@ -151,10 +253,74 @@ ETCS_packet *ETCS_packet::construct(bit_manipulator &r, int m_version)
         }
         if (!highery)
             r.sparefound = true;
-        p = new ETCS_directional_packet();
+        p = create_packet<ETCS_directional_packet>(arena);
     }
     p->copy(r);
     if (NID_PACKET != 0 && r.position-pos != p->L_PACKET)
          r.error = true;
     return p;
-}
\ No newline at end of file
+}
+std::vector<etcs_information*> construct_information(ETCS_packet *packet, euroradio_message *msg)
+{
+    std::vector<etcs_information*> info;
+    information_builder build = packet_table[(unsigned char)packet->NID_PACKET.rawdata].information;
+    if (build != nullptr)
+        build(packet, msg, info);
+    return info;
+}
+std::shared_ptr<ETCS_packet> ETCS_packet::construct(bit_manipulator &r, int m_version, const std::shared_ptr<packet_arena> &arena)
+{
+    // The packet shares ownership of the whole arena
+    return std::shared_ptr<ETCS_packet>(arena, construct(r, m_version, arena.get()));
+}
+size_t packet_arena::measure(const bit_manipulator &r, int m_version)
+{
+    int family = packet_family_index(m_version);
+    int total = r.bits.size()*8;
+    int pos = r.position;
+    size_t size = 0;
+    while (pos <= total-8) {
+        int nid = r.get_bits(pos, 8);
+        if (nid == 255)
+            break;
+        packet_type type = packet_table[nid].type[family];
+        if (type.create == nullptr)
+            type = packet_of<ETCS_directional_packet>();
+        int lpos = pos + (type.directional ? 10 : 8);
+        if (lpos > total-13)
+            break;
+        size += aligned_size(type.size) + aligned_size(sizeof(entry));
+        int length = r.get_bits(lpos, 13);
+        if (length == 0)
+            break;
+        pos += length;
+    }
+    return size;
+}
+packet_arena::packet_arena(size_t size)
+{
+    if (size > 0) {
+        blocks.emplace_back(new unsigned char[size]);
+        current = blocks.back().get();
+        capacity = size;
+    }
+}
+void *packet_arena::allocate(size_t size)
+{
+    size = aligned_size(size);
+    if (used + size > capacity) {
+        // Only reached if the headers did not describe the packets read
+        capacity = std::max(size, (size_t)256);
+        blocks.emplace_back(new unsigned char[capacity]);
+        current = blocks.back().get();
+        used = 0;
+    }
+    void *p = current + used;
+    used += size;
+    return p;
+}
+packet_arena::~packet_arena()
+{
+    for (entry *e = packets; e != nullptr; e = e->next)
+        e->packet->~ETCS_packet();
+}
@@ -10,6 +10,9 @@
 #include "variables.h"
 #include "types.h"
 #include <map>
+#include <memory>
+#include <cstddef>
+class packet_arena;
 struct ETCS_message
 {
     bool valid;
@@ -37,13 +40,12 @@ struct ETCS_packet
     virtual void write_to(bit_manipulator &w)
     {
         int start = w.position;
-        int log_start = w.log_entries.size();
         copy(w);
         L_PACKET.rawdata = w.position-start;
         w.replace(&L_PACKET, start+8);
-        w.log_entries[log_start+1].second = std::to_string(L_PACKET.rawdata);
     }
-    static ETCS_packet *construct(bit_manipulator &r, int m_version);
+    static ETCS_packet *construct(bit_manipulator &r, int m_version, packet_arena *arena=nullptr);
+    static std::shared_ptr<ETCS_packet> construct(bit_manipulator &r, int m_version, const std::shared_ptr<packet_arena> &arena);
 };
 struct ETCS_nondirectional_packet : ETCS_packet
 {
@@ -71,10 +73,49 @@ struct ETCS_directional_packet : ETCS_packet
     void write_to(bit_manipulator &w) override
     {
         int start = w.position;
-        int log_start = w.log_entries.size();
         copy(w);
         L_PACKET.rawdata = w.position-start;
         w.replace(&L_PACKET, start+10);
-        w.log_entries[log_start+2].second = std::to_string(L_PACKET.rawdata);
     }
-};
\ No newline at end of file
+};
+// Storage for the packets decoded from a single telegram or message.
+// The packet headers are scanned first, and the sizes of the packet types
+// found are added up, so that a single block is allocated up front. Vectors
+// inside the packets still use the global allocator.
+// Packets are destroyed together with the arena, once the last reference to
+// any of them is dropped: a single packet kept by the supervision, like
+// a stored MA, keeps all the packets of its telegram alive. These are a few
+// kilobytes per telegram at most, traded for one allocation per telegram.
+class packet_arena
+{
+    struct entry
+    {
+        ETCS_packet *packet;
+        entry *next;
+    };
+    unsigned char *current = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    std::vector<std::unique_ptr<unsigned char[]>> blocks;
+    entry *packets = nullptr;
+    void *allocate(size_t size);
+public:
+    // Bytes needed to create the packets that follow in r
+    static size_t measure(const bit_manipulator &r, int m_version);
+    static size_t aligned_size(size_t size)
+    {
+        return (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+    explicit packet_arena(size_t size);
+    packet_arena(const packet_arena &) = delete;
+    packet_arena &operator=(const packet_arena &) = delete;
+    ~packet_arena();
+    template<typename T>
+    T *create()
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Overaligned packet");
+        T *p = new (allocate(sizeof(T))) T();
+        packets = new (allocate(sizeof(entry))) entry{p, packets};
+        return p;
+    }
+};
@@ -53,13 +53,14 @@ std::shared_ptr<euroradio_message> euroradio_message::build(bit_manipulator &r,
             break;
     }
     msg->copy(r);
+    auto arena = std::make_shared<packet_arena>(packet_arena::measure(r, m_version));
     while (!r.error && r.position<=(r.bits.size()*8-8))
     {
         NID_PACKET_t NID_PACKET;
         r.peek(&NID_PACKET);
         if (NID_PACKET==255)
             break;
-        msg->optional_packets.push_back(std::shared_ptr<ETCS_packet>(ETCS_packet::construct(r, m_version)));
+        msg->optional_packets.push_back(ETCS_packet::construct(r, m_version, arena));
     }
     msg->packets.insert(msg->packets.end(), msg->optional_packets.begin(), msg->optional_packets.end());
     if (msg->L_MESSAGE != size) r.error=true;
@@ -91,13 +92,14 @@ std::shared_ptr<euroradio_message_traintotrack> euroradio_message_traintotrack::
         default: r.sparefound = true; msg = new euroradio_message_traintotrack(); break;
     }
     msg->copy(r);
+    auto arena = std::make_shared<packet_arena>(packet_arena::measure(r, 33));
     while (!r.error && r.position<=(r.bits.size()*8-8))
     {
         NID_PACKET_t NID_PACKET;
         r.peek(&NID_PACKET);
         if (NID_PACKET==255)
             break;
-        msg->optional_packets.push_back(std::shared_ptr<ETCS_packet>(ETCS_packet::construct(r, 33)));
+        msg->optional_packets.push_back(ETCS_packet::construct(r, 33, arena));
     }
     msg->packets.insert(msg->packets.end(), msg->optional_packets.begin(), msg->optional_packets.end());
     if (msg->L_MESSAGE != size) r.error=true;
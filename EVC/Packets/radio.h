@@ -68,7 +68,6 @@ struct euroradio_message : public ETCS_message
         }
         L_MESSAGE.rawdata = w.bits.size();
         w.replace(&L_MESSAGE, 8);
-        w.log_entries[1].second = std::to_string(L_MESSAGE.rawdata);
     }
     static std::shared_ptr<euroradio_message> build(bit_manipulator &r, int m_version);
 };
@@ -130,7 +129,6 @@ struct euroradio_message_traintotrack : public ETCS_message
         }
         L_MESSAGE.rawdata = w.bits.size();
         w.replace(&L_MESSAGE, 8);
-        w.log_entries[1].second = std::to_string(L_MESSAGE.rawdata);
     }
 };
 struct MA_message : euroradio_message
@@ -11,12 +11,22 @@
 #include <vector>
 #include <typeinfo>
 #include <string>
+#include <algorithm>
 template<typename T>
 class ETCS_variable_custom;
+// Variable read or written while logging is enabled.
+// Names are only rendered when the log is printed
+struct bit_log_entry
+{
+    const std::type_info *type;
+    uint64_t rawdata;
+    int position;
+};
 struct bit_manipulator
 {
     std::vector<unsigned char> bits;
-    std::vector<std::pair<std::string,std::string>> log_entries;
+    std::vector<bit_log_entry> log_entries;
+    bool logging=false;
     bool write_mode;
     int position;
     bool error=false;
@@ -26,7 +36,7 @@ struct bit_manipulator
     {
         write_mode = true;
     }
-    bit_manipulator(std::vector<unsigned char> &&bits) : bits(bits), position(0)
+    bit_manipulator(std::vector<unsigned char> &&bits) : bits(std::move(bits)), position(0)
     {
         write_mode = false;
     }
@@ -41,62 +51,78 @@ struct bit_manipulator
         return bits[pos>>3] & (1<<(7-(pos&7)));
     }
     template<typename T>
-    void log(ETCS_variable_custom<T> *var)
+    void log(ETCS_variable_custom<T> *var, int pos)
+    {
+        if (logging)
+            log_entries.push_back({&typeid(*var), (uint64_t)var->rawdata, pos});
+    }
+    // Variable names and values of the logged entries
+    std::vector<std::pair<std::string,std::string>> get_log() const;
+    // Reads count bits (at most 64) starting at pos, which must be available
+    uint64_t get_bits(int pos, int count) const
+    {
+        if (count == 0)
+            return 0;
+        size_t byte = pos>>3;
+        int off = pos&7;
+        size_t n = bits.size()-byte;
+        const unsigned char *b = &bits[byte];
+        uint64_t word;
+        if (n >= 8) {
+            word = (uint64_t)b[0]<<56 | (uint64_t)b[1]<<48 | (uint64_t)b[2]<<40 | (uint64_t)b[3]<<32 |
+                (uint64_t)b[4]<<24 | (uint64_t)b[5]<<16 | (uint64_t)b[6]<<8 | (uint64_t)b[7];
+        } else {
+            word = 0;
+            for (size_t i=0; i<n; i++)
+                word |= (uint64_t)b[i]<<(56-8*i);
+        }
+        word <<= off;
+        if (off + count > 64)
+            word |= b[8]>>(8-off);
+        return word>>(64-count);
+    }
+    // Appends the count lower bits of value
+    void put_bits(uint64_t value, int count)
     {
-        std::string name = typeid(*var).name();
-#ifdef _MSC_VER
-        name = name.substr(6);
-#else
-        name = name.substr(name.find_first_not_of("0123456789"));
-#endif
-        name = name.substr(0, name.size()-2);
-        log_entries.push_back({name, std::to_string(var->rawdata)});
+        while (count > 0) {
+            int off = position&7;
+            if (off == 0)
+                bits.push_back(0);
+            int n = std::min(8-off, count);
+            count -= n;
+            bits.back() |= ((value>>count) & ((1<<n)-1))<<(8-off-n);
+            position += n;
+        }
     }
     template<typename T>
     void read(ETCS_variable_custom<T> *var)
     {
-        T value=0;
-        int count=var->size;
-        while(count-->0) {
-            if ((bits.size()<<3) <= position) {
-                error = true;
-                return;
-            }
-            value = value<<1 | operator[](position++);
+        int total = bits.size()<<3;
+        if (var->size > total-position) {
+            if (position < total)
+                position = total;
+            error = true;
+            return;
         }
-        var->rawdata = value;
+        var->rawdata = (T)get_bits(position, var->size);
+        log(var, position);
+        position += var->size;
         if (!var->is_valid(m_version))
             sparefound = true;
-        log(var);
     }
     template<typename T>
     void peek(ETCS_variable_custom<T> *var, int offset=0)
     {
         int position = this->position+offset;
-        T value=0;
-        int count=var->size;
-        while(count-->0) {
-            if ((bits.size()<<3) <= position) {
-                return;
-            }
-            value = value<<1 | operator[](position++);
-        }
-        var->rawdata = value;
+        if (var->size > (int)(bits.size()<<3)-position)
+            return;
+        var->rawdata = (T)get_bits(position, var->size);
     }
     template<typename T>
     void write(ETCS_variable_custom<T> *var)
     {
-        T value=var->rawdata;
-        int count=var->size;
-        while(count-->0) {
-            bool bit = (value>>count)&1;
-            if ((position & 7) == 0)
-                bits.push_back(bit<<7);
-            else if (bit)
-                bits[position>>3] |= 1<<(7 - (position&7));
-            ++position;
-        }
-        log(var);
+        log(var, position);
+        put_bits((uint64_t)var->rawdata, var->size);
     }
     template<typename T>
     void replace(ETCS_variable_custom<T> *var, int pos)
@@ -109,6 +135,23 @@ struct bit_manipulator
             bits[b] |= ((var->rawdata>>(var->size-i-1)) & 1)<<off;
             ++pos;
         }
+        if (logging) {
+            pos -= var->size;
+            for (auto it = log_entries.rbegin(); it != log_entries.rend(); ++it) {
+                if (it->position == pos) {
+                    it->rawdata = var->rawdata;
+                    break;
+                }
+            }
+        }
     }
     std::string to_base64();
-};
\ No newline at end of file
+};
+// Decodes base64 data into out, reusing its storage.
+// Returns false if the data contains invalid characters
+bool base64_decode_into(const char *data, size_t len, std::vector<unsigned char> &out);
+#ifdef DEBUG_BIT_MANIPULATOR
+// Round-trips random fields through bit_manipulator and compares them
+// with a bit by bit reference implementation
+void fuzz_bit_manipulator(int iterations);
+#endif
\ No newline at end of file
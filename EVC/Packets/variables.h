@@ -582,7 +582,7 @@ struct M_LEVELTR_t : ETCS_variable
         invalid.insert(6);
         invalid.insert(7);
     }
-    Level get_level()
+    Level get_level() const
     {
 
         if (rawdata == N0) return Level::N0;
@@ -2043,7 +2043,7 @@ struct T_VBC_t : ETCS_variable
 struct V_t : ETCS_variable
 {
     V_t() : ETCS_variable(7) {}
-    double get_value()
+    double get_value() const
     {
         return (rawdata*5)/3.6;
     }
@@ -12,85 +12,121 @@
 #include "../Supervision/locomotive_data.h"
 #include "linking.h"
 #include <limits>
-relocable_dist_base *relocable_dist_base::begin = nullptr;
-relocable_dist_base *relocable_dist_base::end = nullptr;
 dist_base dist_base::max = dist_base(std::numeric_limits<double>::max(), 0);
 dist_base dist_base::min = dist_base(std::numeric_limits<double>::lowest(), 0);
-relocable_dist_base::relocable_dist_base()
+static bool is_finite(double d)
 {
-    if (begin == nullptr)
-        begin = this;
-    else
-        prev = end;
-    if (end != nullptr)
-        end->next = this;
-    end = this;
+    return d > std::numeric_limits<double>::lowest() && d < std::numeric_limits<double>::max();
 }
-relocable_dist_base::relocable_dist_base(dist_base d, dist_base ref, int type) : dist_base(d), ref(ref), type(type)
+relocation_group *relocation_registry::find(const relocable_dist_base &d, const dist_base &ref)
 {
-    if (begin == nullptr)
-        begin = this;
-    else
-        prev = end;
-    if (end != nullptr)
-        end->next = this;
-    end = this;
+    for (relocation_group *g : roots) {
+        if (g->balise_based != d.balise_based)
+            continue;
+#if BASELINE == 4
+        if (g->type != d.type || g->relocated_c != d.relocated_c || g->relocated_c_earlier != d.relocated_c_earlier)
+            continue;
+#endif
+        // Odometer based distances keep their own reference
+        if (!g->balise_based || (g->ref.dist == ref.dist && g->ref.orientation == ref.orientation))
+            return g;
+    }
+    groups.push_back(std::make_unique<relocation_group>());
+    relocation_group *g = groups.back().get();
+    g->balise_based = d.balise_based;
+    g->ref = ref;
+#if BASELINE == 4
+    g->type = d.type;
+    g->relocated_c = d.relocated_c;
+    g->relocated_c_earlier = d.relocated_c_earlier;
+#endif
+    roots.push_back(g);
+    return g;
 }
-relocable_dist_base::relocable_dist_base(const relocable_dist_base &d) : dist_base(d), ref(d.ref), type(d.type), balise_based(d.balise_based)
+void relocation_registry::merge_equivalent()
+{
+    for (size_t i=0; i<roots.size(); i++) {
+        relocation_group *target = roots[i];
+        for (size_t j=i+1; j<roots.size(); ) {
+            relocation_group *g = roots[j];
+            bool equivalent = g->balise_based == target->balise_based && (!g->balise_based ||
+                (g->ref.dist == target->ref.dist && g->ref.orientation == target->ref.orientation));
 #if BASELINE == 4
-, relocated_c(d.relocated_c)
-, relocated_c_earlier(d.relocated_c_earlier)
+            equivalent = equivalent && g->type == target->type && g->relocated_c == target->relocated_c && g->relocated_c_earlier == target->relocated_c_earlier;
 #endif
+            if (!equivalent) {
+                ++j;
+                continue;
+            }
+            // Groups already forwarding to g are made to forward to target,
+            // so that resolving a distance never takes more than one step
+            for (auto &other : groups) {
+                if (other->parent == g) {
+                    other->parent = target;
+                    other->offset += g->offset - target->offset;
+                    other->ref_offset += g->ref_offset - target->ref_offset;
+                }
+            }
+            g->parent = target;
+            g->offset -= target->offset;
+            g->ref_offset -= target->ref_offset;
+            roots.erase(roots.begin()+j);
+        }
+    }
+}
+relocation_registry &relocable_dist_base::registry()
 {
-    if (begin == nullptr)
-        begin = this;
-    else
-        prev = end;
-    if (end != nullptr)
-        end->next = this;
-    end = this;
+    // Constructed on first use, as distances with static storage may be relocable
+    static relocation_registry reg;
+    return reg;
 }
-relocable_dist_base::~relocable_dist_base()
+relocable_dist_base::relocable_dist_base(dist_base d, dist_base ref, int type, bool balise_based) : local(d.dist), orientation(d.orientation), local_ref(ref), type(type), balise_based(balise_based)
 {
-    if (prev == nullptr)
-        begin = next;
-    else
-        prev->next = next;
-    if (next == nullptr)
-        end = prev;
-    else
-        next->prev = prev;
+    group = registry().find(*this, ref);
+    if (is_finite(local))
+        local -= orientation * group->total_offset();
+    if (!balise_based && is_finite(local_ref.dist))
+        local_ref.dist -= local_ref.orientation * group->total_ref_offset();
 }
-relocable_dist_base &relocable_dist_base::operator = (const relocable_dist_base& d)
+relocable_dist_base relocable_dist_base::absolute(dist_base d, dist_base ref, int type)
 {
-#if BASELINE == 4
-    relocated_c = d.relocated_c;
-    relocated_c_earlier = d.relocated_c_earlier;
-#endif
-    type = d.type;
-    balise_based = d.balise_based;
-    ref = d.ref;
-    dist_base::operator=(d);
-    return *this;
+    relocable_dist_base rd;
+    rd.local = d.dist;
+    rd.orientation = d.orientation;
+    rd.local_ref = ref;
+    rd.type = type;
+    return rd;
+}
+dist_base relocable_dist_base::get() const
+{
+    if (group == nullptr || !is_finite(local))
+        return dist_base(local, orientation);
+    return dist_base(local + orientation * group->total_offset(), orientation);
+}
+dist_base relocable_dist_base::get_ref() const
+{
+    if (group == nullptr)
+        return local_ref;
+    if (balise_based)
+        return get_group()->ref;
+    if (!is_finite(local_ref.dist))
+        return local_ref;
+    return dist_base(local_ref.dist + local_ref.orientation * group->total_ref_offset(), local_ref.orientation);
 }
 distance distance::from_odometer(const dist_base &dist)
 {
     distance d;
-    relocable_dist_base rd(dist, dist.orientation == 0 ? d_estfront : d_estfront_dir[dist.orientation == -1]);
-    rd.balise_based = false;
-    d.max = d.est = d.min = rd;
-    d.max.type = 1;
-    d.est.type = 0;
-    d.min.type = -1;
+    dist_base ref = dist.orientation == 0 ? d_estfront : d_estfront_dir[dist.orientation == -1];
+    d.max = relocable_dist_base(dist, ref, 1, false);
+    d.est = relocable_dist_base(dist, ref, 0, false);
+    d.min = relocable_dist_base(dist, ref, -1, false);
     return d;
 }
 distance::distance(double val, int orientation, double ref)
 {
-    relocable_dist_base rd(dist_base(val, orientation), dist_base(ref, orientation));
-    max = est = min = rd;
-    max.type = 1;
-    est.type = 0;
-    min.type = -1;
+    max = relocable_dist_base(dist_base(val, orientation), dist_base(ref, orientation), 1);
+    est = relocable_dist_base(dist_base(val, orientation), dist_base(ref, orientation), 0);
+    min = relocable_dist_base(dist_base(val, orientation), dist_base(ref, orientation), -1);
 }
 dist_base &dist_base::operator=(const dist_base &d)
 {
@@ -131,11 +167,11 @@ bool dist_base::operator<(const dist_base &d) const
 confidence_data confidence_data::from_distance(const relocable_dist_base &d)
 {
     confidence_data c;
-    c.ref = d.ref;
+    c.ref = d.get_ref();
     c.locacc = 0;
     if (d.balise_based) {
 #if BASELINE < 4
-        if (d.ref.dist != 0) {
+        if (c.ref.dist != 0) {
             c.locacc = Q_NVLOCACC;
             return c;
         }
@@ -179,13 +215,13 @@ dist_base d_minsafefront(const confidence_data &conf)
 }
 dist_base d_maxsafefront(const relocable_dist_base&ref)
 {
-    if (ref.dist <= std::numeric_limits<double>::lowest() || ref.dist >= std::numeric_limits<double>::max())
+    if (!is_finite(ref.local))
         return d_estfront;
     return d_maxsafe(ref.orientation == 0 ? d_estfront : d_estfront_dir[ref.orientation == -1], confidence_data::from_distance(ref));
 }
 dist_base d_minsafefront(const relocable_dist_base&ref)
 {
-    if (ref.dist <= std::numeric_limits<double>::lowest() || ref.dist >= std::numeric_limits<double>::max())
+    if (!is_finite(ref.local))
         return d_estfront;
     return d_minsafe(ref.orientation == 0 ? d_estfront : d_estfront_dir[ref.orientation == -1], confidence_data::from_distance(ref));
 }
@@ -9,6 +9,8 @@
 #pragma once
 #include <limits>
 #include <cstdlib>
+#include <vector>
+#include <memory>
 using std::abort;
 #define DISTANCE_COW
 extern double odometer_value;
@@ -74,24 +76,88 @@ struct confidence_data
     static confidence_data from_distance(const relocable_dist_base &d);
     static confidence_data basic();
 };
-struct relocable_dist_base : dist_base
+// Relocable distances that are moved together when the LRBG changes.
+// Members store their position relative to the group, so a relocation only
+// updates the offsets of each group. Balise based groups are keyed by the
+// location of the balise group their members are referenced to, the LRBG
+// itself being at 0. Groups found to be equivalent are merged, and then
+// forward to the group they were merged into
+struct relocation_group
 {
-    static relocable_dist_base* begin;
-    static relocable_dist_base* end;
-    relocable_dist_base *prev=nullptr;
-    relocable_dist_base *next=nullptr;
+    bool balise_based;
+    // Reference of every member, for balise based groups
     dist_base ref;
+    // Relocation applied since the group was created, relative
+    // to the parent group once merged
+    double offset = 0;
+    // Relocation of the references of odometer based members
+    double ref_offset = 0;
+    relocation_group *parent = nullptr;
+#if BASELINE == 4
+    int type;
+    bool relocated_c;
+    optional<bg_id> relocated_c_earlier;
+#endif
+    double total_offset() const
+    {
+        return parent != nullptr ? offset + parent->offset : offset;
+    }
+    double total_ref_offset() const
+    {
+        return parent != nullptr ? ref_offset + parent->ref_offset : ref_offset;
+    }
+};
+struct relocation_registry
+{
+    // Every group, also merged ones, as members may still point to them
+    std::vector<std::unique_ptr<relocation_group>> groups;
+    // Groups that are relocated
+    std::vector<relocation_group*> roots;
+    relocation_group *find(const relocable_dist_base &d, const dist_base &ref);
+    // Merges the groups that are relocated in the same way
+    void merge_equivalent();
+};
+struct relocable_dist_base
+{
+    static relocation_registry &registry();
+    // Position relative to the group. Without group, the distance is
+    // absolute and is not relocated
+    double local;
+    int orientation;
+    // Reference, relative to the group for odometer based distances
+    dist_base local_ref;
     int type;
     bool balise_based=true;
+    relocation_group *group=nullptr;
 #if BASELINE == 4
-    bool relocated_c;
+    bool relocated_c=false;
     optional<bg_id> relocated_c_earlier;
 #endif
-    relocable_dist_base();
-    ~relocable_dist_base();
-    relocable_dist_base(dist_base d, dist_base ref, int type=0);
-    relocable_dist_base(const relocable_dist_base &d);
-    relocable_dist_base& operator=(const relocable_dist_base &d);
+    relocable_dist_base() = default;
+    relocable_dist_base(dist_base d, dist_base ref, int type=0, bool balise_based=true);
+    // Scratch distances that are not relocated
+    static relocable_dist_base absolute(dist_base d, dist_base ref, int type=0);
+    dist_base get() const;
+    dist_base get_ref() const;
+    operator dist_base() const
+    {
+        return get();
+    }
+    // Group deciding how the distance is relocated
+    relocation_group *get_group() const
+    {
+        return group != nullptr && group->parent != nullptr ? group->parent : group;
+    }
+    relocable_dist_base &operator+=(const double d)
+    {
+        if (local > std::numeric_limits<double>::lowest() && local < std::numeric_limits<double>::max())
+            local += orientation * d;
+        return *this;
+    }
+    relocable_dist_base &operator-=(const double d)
+    {
+        return *this += -d;
+    }
     relocable_dist_base operator+(const double d) const
     {
         relocable_dist_base dist=*this;
@@ -106,7 +172,31 @@ struct relocable_dist_base : dist_base
     }
     double operator-(const dist_base &d) const
     {
-        return dist_base::operator-(d);
+        return get()-d;
+    }
+    bool operator<(const dist_base &d) const
+    {
+        return get()<d;
+    }
+    bool operator>(const dist_base &d) const
+    {
+        return d<get();
+    }
+    bool operator<=(const dist_base &d) const
+    {
+        return get()<=d;
+    }
+    bool operator>=(const dist_base &d) const
+    {
+        return get()>=d;
+    }
+    bool operator==(const dist_base &d) const
+    {
+        return get()==d;
+    }
+    bool operator!=(const dist_base &d) const
+    {
+        return get()!=d;
     }
 };
 struct distance
@@ -98,10 +98,12 @@ void position_update_bg_passed(bg_id id, bool linked, dist_base pos, int dir)
 {
 #if BASELINE < 4
     if (!linked) {
-        for (relocable_dist_base *d = relocable_dist_base::begin; d != nullptr; d = d->next) {
-            if (d->balise_based && d->ref.dist != 0)
-                d->ref = pos;
+        auto &registry = relocable_dist_base::registry();
+        for (relocation_group *g : registry.roots) {
+            if (g->balise_based && g->ref.dist != 0)
+                g->ref = pos;
         }
+        registry.merge_equivalent();
     }
 #endif
     if (stored_locacc.find(id) == stored_locacc.end())
@@ -226,57 +228,59 @@ void relocate()
 #else
     int reloc_link=0;
 #endif
-    for (relocable_dist_base *d = relocable_dist_base::begin; d != nullptr; d = d->next) {
-        if (!d->balise_based) {
-            *d -= offset;
-            d->ref -= offset;
+    // Each group is relocated as a whole through its offsets
+    auto &registry = relocable_dist_base::registry();
+    for (relocation_group *g : registry.roots) {
+        if (!g->balise_based) {
+            g->offset -= offset;
+            g->ref_offset -= offset;
             ++reloc_odo;
             continue;
         }
 #if BASELINE == 4
-        if (link && !d->relocated_c) {
-            *d -= link->first;
-            d->relocated_c = false;
-            d->relocated_c_earlier = {};
+        if (link && !g->relocated_c) {
+            g->offset -= link->first;
+            g->relocated_c = false;
+            g->relocated_c_earlier = {};
             ++reloc_a;
         } else if (prevsolr) {
             bool rear = false;
-            if (!d->relocated_c_earlier && link) {
-                switch (d->type)
+            if (!g->relocated_c_earlier && link) {
+                switch (g->type)
                 {
                     case 1:
-                        *d -= link->first + 2 * link->second;
+                        g->offset -= link->first + 2 * link->second;
                         break;
                     case -1:
-                        *d -= link->first - 2 * link->second;
+                        g->offset -= link->first - 2 * link->second;
                         break;
                     default:
-                        *d -= link->first;
+                        g->offset -= link->first;
                         break;
                 }
-                d->relocated_c = false;
-                d->relocated_c_earlier = {};
+                g->relocated_c = false;
+                g->relocated_c_earlier = {};
                 ++reloc_b;
             } else {
-                switch (d->type)
+                switch (g->type)
                 {
                     case 1:
-                        *d -= d_maxsafefront(prevsolr->position, prevsolr->locacc) - d_maxsafefront(solr->position, solr->locacc);
+                        g->offset -= d_maxsafefront(prevsolr->position, prevsolr->locacc) - d_maxsafefront(solr->position, solr->locacc);
                         break;
                     case -1:
-                        *d -= d_minsafefront(prevsolr->position, prevsolr->locacc) - d_minsafefront(solr->position, solr->locacc);
+                        g->offset -= d_minsafefront(prevsolr->position, prevsolr->locacc) - d_minsafefront(solr->position, solr->locacc);
                         break;
                     default:
-                        *d -= offset;
+                        g->offset -= offset;
                         break;
                 }
-                d->relocated_c = true;
-                if (d->relocated_c_earlier) {
+                g->relocated_c = true;
+                if (g->relocated_c_earlier) {
                     for (auto it = orbgs.rbegin(); it != orbgs.rend(); ++it) {
                         if (it == *orbgs)
                             break;
-                        if (it == *d->relocated_c_earlier) {
-                            d->relocated_c_earlier = {};
+                        if (it == *g->relocated_c_earlier) {
+                            g->relocated_c_earlier = {};
                             break;
                         }
                     }
@@ -287,29 +291,31 @@ void relocate()
             abort();
         }
 #else
-        if (link && d->ref.dist == 0) {
-            *d -= link->first;
+        if (link && g->ref.dist == 0) {
+            g->offset -= link->first;
             ++reloc_link;
         } else {
-            *d -= offset;
-            if (d->ref.dist != 0)
-                d->ref -= offset;
+            g->offset -= offset;
+            if (g->ref.dist != 0)
+                g->ref -= offset;
             ++reloc_odo;
         }
 #endif
     }
+    registry.merge_equivalent();
 #ifdef DEBUG_ODOMETER
 #if BASELINE == 4
     dbg += "Relocated a): "+reloc_a+"\r\n";
     dbg += "Relocated b): "+reloc_b+"\r\n";
     dbg += "Relocated c): "+reloc_c+"\r\n";
 #else
-    dbg += "Relocated agains link: "+std::to_string(reloc_link)+"\r\n";
+    dbg += "Groups relocated agains link: "+std::to_string(reloc_link)+"\r\n";
 #endif
-    dbg += "Relocated against odo: "+std::to_string(reloc_odo);
+    dbg += "Groups relocated against odo: "+std::to_string(reloc_odo);
     platform->debug_print(dbg);
 #endif
     relocate_linking();
+    recalculate_gradient();
     recalculate_MRSP();
 }
 optional<distance> get_reference_location(bg_id bg, bool linked, bool check_passed)
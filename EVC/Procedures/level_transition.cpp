@@ -229,7 +229,7 @@ void level_transition_received(level_transition_information info)
     level_to_ack = ongoing_transition->leveldata.level;
     ntc_to_ack = ongoing_transition->leveldata.nid_ntc;
 }
-level_transition_information::level_transition_information(LevelTransitionOrder o)
+level_transition_information::level_transition_information(const LevelTransitionOrder &o)
 {
     if (o.D_LEVELTR == o.D_LEVELTR.Now) {
         immediate = true;
@@ -247,7 +247,7 @@ level_transition_information::level_transition_information(LevelTransitionOrder
     }
     set_leveldata(priorities);
 }
-level_transition_information::level_transition_information(ConditionalLevelTransitionOrder o)
+level_transition_information::level_transition_information(const ConditionalLevelTransitionOrder &o)
 {
     immediate = true;
     std::vector<target_level_information> priorities;
@@ -37,8 +37,8 @@ struct level_transition_information
     target_level_information leveldata;
     std::vector<level_information> priority_table;
     level_transition_information() = default;
-    level_transition_information(LevelTransitionOrder o);
-    level_transition_information(ConditionalLevelTransitionOrder o);
+    level_transition_information(const LevelTransitionOrder &o);
+    level_transition_information(const ConditionalLevelTransitionOrder &o);
     void set_leveldata(std::vector<target_level_information> &priorities);
 };
 void update_level_status();
@@ -411,7 +411,7 @@ void send_failed_msg(stm_object *stm)
     text_message msg(get_ntc_name(stm->nid_stm) + get_text(" failed"), true, true, 2, [stm](text_message &msg){return msg.acknowledged;});
     add_message(msg);
 }
-bool mode_filter(std::shared_ptr<etcs_information> info, const std::list<std::shared_ptr<etcs_information>> &message);
+bool mode_filter(const std::shared_ptr<etcs_information> &info, const std::list<std::shared_ptr<etcs_information>> &message);
 void request_STM_max_speed(stm_object *stm, double speed)
 {
     if (ongoing_transition && ongoing_transition->leveldata.level == Level::NTC && ongoing_transition->leveldata.nid_ntc != nid_ntc) {
@@ -7,20 +7,47 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "acceleration.h"
+acceleration::acceleration(std::vector<dist_base> dists, std::vector<double> speeds) : dist_step(std::move(dists)), speed_step(std::move(speeds))
+{
+    // Every acceleration starts at the lowest distance and at standstill
+    dist_step.insert(dist_step.begin(), dist_base(std::numeric_limits<double>::lowest(), 0));
+    speed_step.insert(speed_step.begin(), 0);
+    // Stable sort, so that the first inserted of two equivalent distances is kept
+    std::stable_sort(dist_step.begin(), dist_step.end());
+    dist_step.erase(std::unique(dist_step.begin(), dist_step.end(), [](const dist_base &a, const dist_base &b) {
+        return !(a < b) && !(b < a);
+    }), dist_step.end());
+    std::sort(speed_step.begin(), speed_step.end());
+    speed_step.erase(std::unique(speed_step.begin(), speed_step.end()), speed_step.end());
+    accelerations.assign(dist_step.size()*speed_step.size(), 0);
+}
 acceleration operator+(const acceleration &a1, const acceleration &a2)
 {
-    acceleration an = acceleration();
-    an.dist_step = a1.dist_step;
-    an.speed_step = a1.speed_step;
-    an.dist_step.insert(a2.dist_step.begin(), a2.dist_step.end());
-    an.speed_step.insert(a2.speed_step.begin(), a2.speed_step.end());
-    for (auto &d : an.dist_step) {
-        for (auto &V : an.speed_step) {
-            an.accelerations[d][V] = a1(V, d) + a2(V, d);
+    std::vector<dist_base> dists;
+    dists.reserve(a1.dist_step.size()+a2.dist_step.size());
+    std::vector<double> speeds;
+    speeds.reserve(a1.speed_step.size()+a2.speed_step.size());
+    dists.insert(dists.end(), a1.dist_step.begin(), a1.dist_step.end());
+    dists.insert(dists.end(), a2.dist_step.begin(), a2.dist_step.end());
+    speeds.insert(speeds.end(), a1.speed_step.begin(), a1.speed_step.end());
+    speeds.insert(speeds.end(), a2.speed_step.begin(), a2.speed_step.end());
+    acceleration an(std::move(dists), std::move(speeds));
+    // Both grids are walked with cursors, since the merged breakpoints are
+    // visited in increasing order
+    size_t d1 = 0;
+    size_t d2 = 0;
+    for (size_t i=0; i<an.dist_step.size(); i++) {
+        const dist_base &d = an.dist_step[i];
+        while (d1+1 < a1.dist_step.size() && !(d < a1.dist_step[d1+1])) d1++;
+        while (d2+1 < a2.dist_step.size() && !(d < a2.dist_step[d2+1])) d2++;
+        size_t v1 = 0;
+        size_t v2 = 0;
+        for (size_t j=0; j<an.speed_step.size(); j++) {
+            double V = an.speed_step[j];
+            while (v1+1 < a1.speed_step.size() && a1.speed_step[v1+1] <= V) v1++;
+            while (v2+1 < a2.speed_step.size() && a2.speed_step[v2+1] <= V) v2++;
+            an.value(i, j) = a1.value(d1, v1) + a2.value(d2, v2);
         }
     }
-    /*auto ac1 = a1.accel;
-    auto ac2 = a2.accel;
-    an.accel = [ac1,ac2](double V, distance d) {return ac1(V,d) + ac2(V,d);};*/
     return an;
 }
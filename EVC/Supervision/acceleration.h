@@ -7,26 +7,49 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #pragma once
-//#include <functional>
-#include <set>
-#include <map>
+#include <vector>
+#include <algorithm>
 #include "../Position/distance.h"
+// Step function of the acceleration over distance and speed.
+// Breakpoints are kept sorted in contiguous arrays and the values
+// are stored in a row-major grid, one row per distance step.
 struct acceleration
 {
-    std::map<dist_base, std::map<double, double>> accelerations;
-    std::set<dist_base> dist_step;
-    std::set<double> speed_step;
-    acceleration()
+    std::vector<dist_base> dist_step;
+    std::vector<double> speed_step;
+    std::vector<double> accelerations;
+    acceleration() : acceleration({}, {}) {}
+    acceleration(std::vector<dist_base> dists, std::vector<double> speeds);
+    size_t dist_index(const dist_base &d) const
     {
-        accelerations[dist_base(std::numeric_limits<double>::lowest(), 0)][0] = 0;
-        dist_step.insert(dist_base(std::numeric_limits<double>::lowest(), 0));
-        speed_step.insert(0);
+        return std::upper_bound(dist_step.begin(), dist_step.end(), d) - dist_step.begin() - 1;
+    }
+    size_t speed_index(double V) const
+    {
+        return std::upper_bound(speed_step.begin(), speed_step.end(), V) - speed_step.begin() - 1;
+    }
+    double &value(size_t d, size_t v)
+    {
+        return accelerations[d*speed_step.size()+v];
+    }
+    double value(size_t d, size_t v) const
+    {
+        return accelerations[d*speed_step.size()+v];
     }
     double operator()(const double V, const dist_base &d) const
     {
-        return (--(--accelerations.upper_bound(d))->second.upper_bound(V))->second;
+        return value(dist_index(d), speed_index(V));
+    }
+    template<typename F>
+    void fill(F &&f)
+    {
+        for (size_t i=0; i<dist_step.size(); i++) {
+            for (size_t j=0; j<speed_step.size(); j++) {
+                accelerations[i*speed_step.size()+j] = f(speed_step[j], dist_step[i]);
+            }
+        }
     }
     friend acceleration operator+(const acceleration &a1, const acceleration &a2);
-    
+
 };
 acceleration operator+(const acceleration &a1, const acceleration &a2);
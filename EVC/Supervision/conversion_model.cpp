@@ -18,30 +18,26 @@
 #include <cmath>
 acceleration get_A_gradient(const std::map<dist_base, double> &gradient, double default_gradient)
 {
-    acceleration A_gradient;
-    A_gradient.dist_step.insert(dist_base(std::numeric_limits<double>::lowest(), 0));
-    A_gradient.speed_step.insert(0);
+    std::vector<dist_base> dists;
+    dists.reserve(2*gradient.size());
     for (auto it=gradient.begin(); it!=gradient.end(); ++it) {
-        A_gradient.dist_step.insert(it->first);
-        A_gradient.dist_step.insert(it->first-L_TRAIN);
+        dists.push_back(it->first);
+        dists.push_back(it->first-L_TRAIN);
     }
-    for (auto &d : A_gradient.dist_step) {
-        for (auto &V : A_gradient.speed_step) {
-            if (gradient.empty() || d-L_TRAIN<gradient.begin()->first || (--gradient.end())->first >= d) {
-                A_gradient.accelerations[d][V] = default_gradient;
-                continue;
-            }
-            double grad = 50000;
-            for (auto it=--gradient.upper_bound(d-L_TRAIN); it!=gradient.upper_bound(d); ++it) {
-                grad = std::min(grad, it->second*1000);
-            }
-            const double g = 9.81;
-            if (M_rotating_nom > 0)
-                A_gradient.accelerations[d][V] = g*grad/(1000+10*M_rotating_nom);
-            else
-                A_gradient.accelerations[d][V] = g*grad/(1000+10*((grad>0) ? M_rotating_max : M_rotating_min));
+    acceleration A_gradient(std::move(dists), {});
+    A_gradient.fill([&gradient, default_gradient](double V, const dist_base &d) {
+        if (gradient.empty() || d-L_TRAIN<gradient.begin()->first || (--gradient.end())->first >= d)
+            return default_gradient;
+        double grad = 50000;
+        for (auto it=--gradient.upper_bound(d-L_TRAIN); it!=gradient.upper_bound(d); ++it) {
+            grad = std::min(grad, it->second*1000);
         }
-    }
+        const double g = 9.81;
+        if (M_rotating_nom > 0)
+            return g*grad/(1000+10*M_rotating_nom);
+        else
+            return g*grad/(1000+10*((grad>0) ? M_rotating_max : M_rotating_min));
+    });
     return A_gradient;
 }
 double T_brake_emergency_cm0;
@@ -75,56 +71,57 @@ acceleration get_A_brake_emergency(bool use_active_combination)
 {
     if (conversion_model_used)
         return A_brake_emergency;
-    acceleration ac;
+    std::vector<dist_base> dists;
     for (auto it = active_combination.begin(); it!=active_combination.end(); ++it)
-        ac.dist_step.insert(it->first);
+        dists.push_back(it->first);
+    std::vector<double> speeds;
     for (int i=0; i<16; i++) {
         for (auto it = A_brake_emergency_combination[i].begin(); it!=A_brake_emergency_combination[i].end(); ++it)
-            ac.speed_step.insert(it->first);
-    }
-    for (auto &d : ac.dist_step) {
-        for (auto &V : ac.speed_step) {
-            int comb = use_active_combination ? (--active_combination.upper_bound(d))->second.second : 15;
-            ac.accelerations[d][V] = (--A_brake_emergency_combination[comb].upper_bound(V))->second;
-        }
+            speeds.push_back(it->first);
     }
+    acceleration ac(std::move(dists), std::move(speeds));
+    ac.fill([use_active_combination](double V, const dist_base &d) {
+        int comb = use_active_combination ? (--active_combination.upper_bound(d))->second.second : 15;
+        return (--A_brake_emergency_combination[comb].upper_bound(V))->second;
+    });
     return ac;
 }
 acceleration get_A_brake_service(bool use_active_combination)
 {
     if (conversion_model_used)
         return A_brake_service;
-    acceleration ac;
+    std::vector<dist_base> dists;
     for (auto it = active_combination.begin(); it!=active_combination.end(); ++it)
-        ac.dist_step.insert(it->first);
+        dists.push_back(it->first);
+    std::vector<double> speeds;
     for (int i=0; i<8; i++) {
         for (auto it = A_brake_service_combination[i].begin(); it!=A_brake_service_combination[i].end(); ++it)
-            ac.speed_step.insert(it->first);
-    }
-    for (auto &d : ac.dist_step) {
-        for (auto &V : ac.speed_step) {
-            int comb = use_active_combination ? (--active_combination.upper_bound(d))->second.first : 7;
-            ac.accelerations[d][V] = (--A_brake_service_combination[comb].upper_bound(V))->second;
-        }
+            speeds.push_back(it->first);
     }
+    acceleration ac(std::move(dists), std::move(speeds));
+    ac.fill([use_active_combination](double V, const dist_base &d) {
+        int comb = use_active_combination ? (--active_combination.upper_bound(d))->second.first : 7;
+        return (--A_brake_service_combination[comb].upper_bound(V))->second;
+    });
     return ac;
 }
 acceleration get_A_brake_normal_service(acceleration service)
 {
     if (conversion_model_used && A_brake_normal_service_combination.empty())
         return A_brake_service;
-    acceleration ac;
+    std::vector<dist_base> dists;
     for (auto it = active_combination.begin(); it!=active_combination.end(); ++it)
-        ac.dist_step.insert(it->first);
-    for (auto it = A_brake_normal_service_combination[brake_position != PassengerP].begin(); it!=A_brake_normal_service_combination[brake_position != PassengerP].end(); ++it) {
+        dists.push_back(it->first);
+    std::vector<double> speeds;
+    auto &combination = A_brake_normal_service_combination[brake_position != PassengerP];
+    for (auto it = combination.begin(); it!=combination.end(); ++it) {
         for (auto it2 = it->second.begin(); it2!=it->second.end(); ++it2)
-            ac.speed_step.insert(it2->first);
-    }
-    for (auto &d : ac.dist_step) {
-        for (auto &V : ac.speed_step) {
-            ac.accelerations[d][V] = (--(--A_brake_normal_service_combination[brake_position != PassengerP].upper_bound(service(0,d)))->second.upper_bound(V))->second;
-        }
+            speeds.push_back(it2->first);
     }
+    acceleration ac(std::move(dists), std::move(speeds));
+    ac.fill([&combination, &service](double V, const dist_base &d) {
+        return (--(--combination.upper_bound(service(0,d)))->second.upper_bound(V))->second;
+    });
     return ac;
 }
 double get_T_brake_emergency(dist_base d)
@@ -144,6 +141,7 @@ double Kwet_rst(double V, dist_base d)
     return (--Kwet_rst_combination[(--active_combination.upper_bound(d))->second.second].upper_bound(V))->second;
 }
 std::map<double,double> Kn[2];
+unsigned brake_model_version = 0;
 void set_brake_model(json &traindata)
 {
     reset();
@@ -241,6 +239,7 @@ void set_brake_model(json &traindata)
             }
         }
     }
+    brake_model_version++;
     update_brake_contributions();
 }
 std::map<double, double> Kv_int;
@@ -281,16 +280,14 @@ acceleration conversion_acceleration(double lambda_0)
         AD[V_lim] = acel[4];
     if (V_lim<=180)
         AD[180] = acel[4];
-    acceleration a_calculated;
+    std::vector<double> speeds;
     for (auto it=AD.begin(); it!=AD.end(); ++it) {
-        a_calculated.speed_step.insert(it->first/3.6);
-    }
-
-    for (auto &d : a_calculated.dist_step) {
-        for (auto &V : a_calculated.speed_step) {
-            a_calculated.accelerations[d][V] = (--AD.upper_bound(V*3.6))->second;
-        }
+        speeds.push_back(it->first/3.6);
     }
+    acceleration a_calculated({}, std::move(speeds));
+    a_calculated.fill([&AD](double V, const dist_base &d) {
+        return (--AD.upper_bound(V*3.6))->second;
+    });
     return a_calculated;
 }
 inline double T_brake_basic(double L, double a, double b, double c)
@@ -372,4 +369,5 @@ void set_conversion_model()
     } else {
         conversion_model_used = false;
     }
+    brake_model_version++;
 }
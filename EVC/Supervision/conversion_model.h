@@ -35,4 +35,5 @@ extern bool conversion_model_used;
 double Kdry_rst(double V, double EBCL, dist_base d);
 double Kwet_rst(double V, dist_base d);
 extern std::map<dist_base,std::pair<int,int>> active_combination;
-extern bool slippery_rail_driver;
\ No newline at end of file
+extern bool slippery_rail_driver;
+extern unsigned brake_model_version;
\ No newline at end of file
@@ -7,27 +7,29 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include <cmath>
+#include <functional>
+#include "curve_calc.h"
 #include "conversion_model.h"
 dist_base distance_curve(const acceleration &a, const dist_base &dref, double vref, double vel)
 {
-    if (a.speed_step.empty() || vref<*a.speed_step.begin() || a.dist_step.empty() || dref<*a.dist_step.begin())
+    if (a.speed_step.empty() || vref<a.speed_step.front() || a.dist_step.empty() || dref<a.dist_step.front())
         return dist_base(std::numeric_limits<float>::min(), 0);
-    auto v = --a.speed_step.upper_bound(vref);
-    auto d = --a.dist_step.upper_bound(dref);
+    size_t v = a.speed_index(vref);
+    size_t d = a.dist_index(dref);
     bool dec = 1; //Decceleration curve
     bool inc = vel>vref;
     bool fwd = dec != inc;
-    auto vnext = inc ? next(v) : v;
-    auto dnext = fwd ? next(d) : d;
+    size_t vnext = inc ? v+1 : v;
+    size_t dnext = fwd ? d+1 : d;
     dist_base pos = dref;
     double v02 = vref*vref;
     double v2 = vel*vel;
     for (;;) {
-        double dac = (dec ? -2 : 2)*a(*v,*d);
-        bool vend = vnext == a.speed_step.end();
-        bool dend = dnext == a.dist_step.end();
-        double vv2 = vend ? (inc ? 1e9 : -1) : (*vnext)*(*vnext);
-        double vd2 = (dend || dnext->dist <= std::numeric_limits<double>::lowest() || dnext->dist >= std::numeric_limits<double>::max()) ? (inc ? 1e9 : -1) : dac*(*dnext-pos)+v02;
+        double dac = (dec ? -2 : 2)*a.value(d,v);
+        bool vend = vnext == a.speed_step.size();
+        bool dend = dnext == a.dist_step.size();
+        double vv2 = vend ? (inc ? 1e9 : -1) : a.speed_step[vnext]*a.speed_step[vnext];
+        double vd2 = (dend || a.dist_step[dnext].dist <= std::numeric_limits<double>::lowest() || a.dist_step[dnext].dist >= std::numeric_limits<double>::max()) ? (inc ? 1e9 : -1) : dac*(a.dist_step[dnext]-pos)+v02;
         if (inc ? (v2<=std::min(vv2,vd2)) : (v2>=std::max(vv2,vd2))) {
             pos += (v2-v02)/dac;
             v02 = v2;
@@ -44,7 +46,7 @@ dist_base distance_curve(const acceleration &a, const dist_base &dref, double vr
             }
         } else {
             v02 = vd2;
-            pos = *dnext;
+            pos = a.dist_step[dnext];
             if (fwd) {
                 d++;
                 dnext++;
@@ -58,25 +60,25 @@ dist_base distance_curve(const acceleration &a, const dist_base &dref, double vr
 };
 double speed_curve(const acceleration &a, const dist_base &dref, double vref, dist_base dist)
 {
-    if (a.speed_step.empty() || vref<*a.speed_step.begin() || a.dist_step.empty() || dref<*a.dist_step.begin())
+    if (a.speed_step.empty() || vref<a.speed_step.front() || a.dist_step.empty() || dref<a.dist_step.front())
         return 0;
-    if (dist<*a.dist_step.begin())
-        dist = *a.dist_step.begin();
-    auto v = --a.speed_step.upper_bound(vref);
-    auto d = --a.dist_step.upper_bound(dref);
+    if (dist<a.dist_step.front())
+        dist = a.dist_step.front();
+    size_t v = a.speed_index(vref);
+    size_t d = a.dist_index(dref);
     bool dec = 1; //Decceleration curve
     bool fwd = dist>dref;
     bool inc = dec != fwd;
-    auto vnext = inc ? next(v) : v;
-    auto dnext = fwd ? next(d) : d;
+    size_t vnext = inc ? v+1 : v;
+    size_t dnext = fwd ? d+1 : d;
     dist_base pos = dref;
     double v02 = vref*vref;
     for (;;) {
-        double dac = (dec ? -2 : 2)*a(*v,*d);
-        bool vend = vnext == a.speed_step.end();
-        bool dend = dnext == a.dist_step.end();
-        double vv2 = vend ? (inc ? 1e9 : -1) : (*vnext)*(*vnext);
-        double vd2 = (dend || dnext->dist <= std::numeric_limits<double>::lowest() || dnext->dist >= std::numeric_limits<double>::max()) ? (inc ? 1e9 : -1) : dac*(*dnext-pos)+v02;
+        double dac = (dec ? -2 : 2)*a.value(d,v);
+        bool vend = vnext == a.speed_step.size();
+        bool dend = dnext == a.dist_step.size();
+        double vv2 = vend ? (inc ? 1e9 : -1) : a.speed_step[vnext]*a.speed_step[vnext];
+        double vd2 = (dend || a.dist_step[dnext].dist <= std::numeric_limits<double>::lowest() || a.dist_step[dnext].dist >= std::numeric_limits<double>::max()) ? (inc ? 1e9 : -1) : dac*(a.dist_step[dnext]-pos)+v02;
         double v2 = std::max(dac*(dist-pos)+v02, 0.0);
         if (inc ? (v2<=std::min(vv2,vd2)) : (v2>=std::max(vv2,vd2))) {
             pos = dist;
@@ -94,7 +96,7 @@ double speed_curve(const acceleration &a, const dist_base &dref, double vref, di
             }
         } else {
             v02 = vd2;
-            pos = *dnext;
+            pos = a.dist_step[dnext];
             if (fwd) {
                 d++;
                 dnext++;
@@ -106,3 +108,99 @@ double speed_curve(const acceleration &a, const dist_base &dref, double vref, di
     }
     return sqrt(v02);
 }
+static bool trace_curve(const acceleration &a, dist_base pos, double v02, size_t d, size_t v, bool fwd, std::vector<dist_base> &poss, std::vector<double> &v2s, std::vector<double> &dacs)
+{
+    // Same walk as distance_curve(), up to standstill when going forward and
+    // until both the speed and the distance steps are exhausted otherwise
+    bool inc = !fwd;
+    size_t vnext = inc ? v+1 : v;
+    size_t dnext = fwd ? d+1 : d;
+    for (;;) {
+        double dac = -2*a.value(d,v);
+        if (dac >= 0)
+            return false;
+        bool vend = vnext == a.speed_step.size();
+        bool dend = dnext == a.dist_step.size() || a.dist_step[dnext].dist <= std::numeric_limits<double>::lowest() || a.dist_step[dnext].dist >= std::numeric_limits<double>::max();
+        if (inc && vend && dend) {
+            dacs.push_back(dac);
+            return true;
+        }
+        double vv2 = vend ? (inc ? 1e9 : -1) : a.speed_step[vnext]*a.speed_step[vnext];
+        double vd2 = dend ? (inc ? 1e9 : -1) : dac*(a.dist_step[dnext]-pos)+v02;
+        if (!inc && 0 >= std::max(vv2,vd2)) {
+            pos += (0-v02)/dac;
+            v02 = 0;
+        } else if (inc ? (vv2<vd2) : (vv2>vd2)) {
+            pos += (vv2-v02)/dac;
+            v02 = vv2;
+            if (inc) {
+                v++;
+                vnext++;
+            } else {
+                v--;
+                vnext--;
+            }
+        } else {
+            v02 = vd2;
+            pos = a.dist_step[dnext];
+            if (fwd) {
+                d++;
+                dnext++;
+            } else {
+                d--;
+                dnext--;
+            }
+        }
+        poss.push_back(pos);
+        v2s.push_back(v02);
+        dacs.push_back(dac);
+        if (fwd && v02 == 0)
+            return true;
+    }
+}
+curve_table::curve_table(const acceleration &a, const dist_base &dref, double vref)
+{
+    if (a.speed_step.empty() || vref<a.speed_step.front() || a.dist_step.empty() || dref<a.dist_step.front())
+        return;
+    size_t v = a.speed_index(vref);
+    size_t d = a.dist_index(dref);
+    std::vector<dist_base> bpos;
+    std::vector<double> bv2;
+    std::vector<double> bdac;
+    if (!trace_curve(a, dref, vref*vref, d, v, false, bpos, bv2, bdac))
+        return;
+    pos.assign(bpos.rbegin(), bpos.rend());
+    v2.assign(bv2.rbegin(), bv2.rend());
+    dac.assign(bdac.rbegin()+1, bdac.rend());
+    dac_front = bdac.back();
+    ref = pos.size();
+    pos.push_back(dref);
+    v2.push_back(vref*vref);
+    if (vref > 0 && !trace_curve(a, dref, vref*vref, d, v, true, pos, v2, dac))
+        return;
+    valid = true;
+}
+dist_base curve_table::distance(double vel) const
+{
+    double v = vel*vel;
+    // Knots closer to the reference are used as origin, like the integrator does
+    if (v > v2.front())
+        return pos.front() + (v-v2.front())/dac_front;
+    size_t j = std::upper_bound(v2.begin(), v2.end(), v, std::greater<double>()) - v2.begin();
+    if (j == v2.size())
+        return pos.back();
+    size_t i = j-1;
+    size_t o = i >= ref ? i : j;
+    return pos[o] + (v-v2[o])/dac[i];
+}
+double curve_table::speed(const dist_base &dist) const
+{
+    size_t j = std::upper_bound(pos.begin(), pos.end(), dist) - pos.begin();
+    if (j == 0)
+        return sqrt(std::max(v2.front() + dac_front*(dist-pos.front()), 0.0));
+    if (j == pos.size())
+        return sqrt(v2.back());
+    size_t i = j-1;
+    size_t o = i >= ref ? i : j;
+    return sqrt(std::max(v2[o] + dac[i]*(dist-pos[o]), 0.0));
+}
@@ -7,6 +7,28 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #pragma once
+#include <vector>
 #include "../Position/distance.h"
+#include "acceleration.h"
 dist_base distance_curve(const acceleration &a, const dist_base &dref, double vref, double vel);
 double speed_curve(const acceleration &a, const dist_base &dref, double vref, dist_base dist);
+// Braking curve through a reference point, stored as the states visited by
+// distance_curve() and speed_curve(). Between two knots v^2 is linear in
+// the distance, so evaluation is a binary search and a closed-form solve.
+struct curve_table
+{
+    std::vector<dist_base> pos;
+    std::vector<double> v2;
+    // Slope of v^2 between knot i and knot i+1
+    std::vector<double> dac;
+    // Slope of v^2 before the first knot, towards higher speeds
+    double dac_front;
+    // Index of the reference knot
+    size_t ref;
+    // False if the curve is not monotone, in which case the integrator must be used
+    bool valid = false;
+    curve_table() = default;
+    curve_table(const acceleration &a, const dist_base &dref, double vref);
+    dist_base distance(double vel) const;
+    double speed(const dist_base &dist) const;
+};
@@ -7,6 +7,7 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "national_values.h"
+#include "conversion_model.h"
 #include "../optional.h"
 #include "../Packets/logging.h"
 #include "../TrainSubsystems/cold_movement.h"
@@ -64,6 +65,7 @@ double A_NVMAXREDADH3;
 std::set<int> NV_NID_Cs;
 void nv_changed()
 {
+    brake_model_version++;
     //set_conversion_correction_values();
     if (!SR_speed_override)
         SR_speed = speed_restriction(V_NVSTFF, distance::from_odometer(dist_base::min), distance::from_odometer(dist_base::max), false);
@@ -222,9 +224,10 @@ void setup_national_values()
     }
     bit_manipulator r(j.get<std::string>());
     NationalValues nv = NationalValues();
+    r.logging = true;
     nv.copy(r);
     platform->debug_print("Loading national values");
-    for (auto &var : r.log_entries)
+    for (auto &var : r.get_log())
         platform->debug_print(var.first+"="+var.second);
     if (r.error || r.sparefound || r.position != nv.L_PACKET) {
         reset_national_values();
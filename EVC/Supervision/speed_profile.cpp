@@ -17,6 +17,11 @@
 #include <vector>
 #include <map>
 #include <cmath>
+#include <numeric>
+#include <algorithm>
+#ifdef DEBUG_MRSP_CONSISTENCY
+#include "platform_runtime.h"
+#endif
 std::map<relocable_dist_base,double,std::less<>> MRSP;
 std::list<speed_restriction> SSP;
 std::list<speed_restriction> ASP;
@@ -39,6 +44,8 @@ struct gradient_profile_element
 };
 std::list<gradient_profile_element> gradient_profile;
 std::map<dist_base, double> gradient;
+// The gradient is only rebuilt when its elements have changed
+static bool gradient_profile_changed = true;
 int default_gradient_tsr;
 void delete_back_info()
 {
@@ -50,10 +57,12 @@ void delete_back_info()
         return r.get_end() < mindist;
     });
     for (auto it = gradient_profile.begin(); it != gradient_profile.end(); ) {
-        if (it->end.min < mindist)
+        if (it->end.min < mindist) {
             it = gradient_profile.erase(it);
-        else
+            gradient_profile_changed = true;
+        } else {
             ++it;
+        }
     }
     TSRs.remove_if([mindist](const TSR &t) {
         return t.restriction.get_end()<mindist;
@@ -101,6 +110,7 @@ void delete_ASP()
 }
 void delete_gradient(const distance &start)
 {
+    gradient_profile_changed = true;
     for (auto it = gradient_profile.begin(); it != gradient_profile.end(); ) {
         if (it->start.max > start.min) {
             it = gradient_profile.erase(it);
@@ -115,6 +125,7 @@ void delete_gradient(const distance &start)
 void delete_gradient()
 {
     gradient_profile.clear();
+    gradient_profile_changed = true;
 }
 void delete_TSR(const distance &d)
 {
@@ -128,15 +139,84 @@ void delete_track_info()
 {
     SSP.clear();
     gradient_profile.clear();
+    gradient_profile_changed = true;
     TSRs.clear();
     recalculate_MRSP();
 }
+#ifdef DEBUG_MRSP_CONSISTENCY
+static std::map<relocable_dist_base,double,std::less<>> scan_MRSP(const std::vector<std::reference_wrapper<speed_restriction>> &restrictions)
+{
+    std::map<relocable_dist_base,double,std::less<>> mrsp;
+    std::set<relocable_dist_base> critical_points;
+    for (auto it = restrictions.begin(); it != restrictions.end(); ++it) {
+        critical_points.insert(it->get().get_start());
+        critical_points.insert(it->get().get_end());
+    }
+    for (auto it = critical_points.begin(); it != --critical_points.end(); ++it) {
+        double spd=400;
+        for (auto it2 = restrictions.begin(); it2 != restrictions.end(); ++it2) {
+            if (it2->get().get_start()<=*it && it2->get().get_end()>*it && it2->get().get_speed()<spd)
+                spd = it2->get().get_speed();
+        }
+        if (mrsp.size()==0 || (--mrsp.upper_bound(*it))->second!=spd)
+            mrsp[*it] = spd;
+    }
+    return mrsp;
+}
+#endif
+static void sweep_MRSP(const std::vector<std::reference_wrapper<speed_restriction>> &restrictions)
+{
+    // Every restriction contributes a start and an end point. Sorting them once
+    // and keeping the speeds of the currently active restrictions in a multiset
+    // yields the most restrictive speed of each interval in O(n log n).
+    // The sort is stable so that equivalent points keep the representative that
+    // was inserted first, as a std::set of critical points would do.
+    std::vector<relocable_dist_base> points;
+    points.reserve(2*restrictions.size());
+    for (auto &r : restrictions) {
+        points.push_back(r.get().get_start());
+        points.push_back(r.get().get_end());
+    }
+    std::vector<size_t> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&points](size_t a, size_t b) {
+        return points[a] < points[b];
+    });
+    std::multiset<double> active;
+    for (size_t i = 0; i < order.size(); ) {
+        const relocable_dist_base &point = points[order[i]];
+        size_t j = i;
+        for (; j < order.size() && !(point < points[order[j]]); ++j) {
+            size_t r = order[j]/2;
+            // Empty or inverted restrictions never cover any point
+            if (!(points[2*r] < points[2*r+1]))
+                continue;
+            double spd = restrictions[r].get().get_speed();
+            if (order[j] % 2 == 0)
+                active.insert(spd);
+            else
+                active.erase(active.find(spd));
+        }
+        if (j == order.size())
+            break;
+        double spd = active.empty() ? 400 : std::min(400.0, *active.begin());
+        if (MRSP.empty() || MRSP.rbegin()->second != spd)
+            MRSP.emplace_hint(MRSP.end(), point, spd);
+        i = j;
+    }
+}
+// The MRSP is rebuilt in full from the restrictions that apply to the current
+// mode. Changes are only localised downstream: set_supervised_targets() keeps
+// the targets whose braking curves are not affected by them
 void recalculate_MRSP()
 {
     delete_back_info();
-    recalculate_gradient();
+    if (gradient_profile_changed)
+        recalculate_gradient();
     MRSP.clear();
-    std::list<std::reference_wrapper<speed_restriction>> restrictions;
+    std::vector<std::reference_wrapper<speed_restriction>> restrictions;
+    if (mode == Mode::FS || mode == Mode::OS || mode == Mode::LS)
+        restrictions.insert(restrictions.end(), signal_speeds.begin(), signal_speeds.end());
     if (mode == Mode::FS || mode == Mode::OS || mode == Mode::LS)
         restrictions.insert(restrictions.end(), SSP.begin(), SSP.end());
     if (mode == Mode::FS || mode == Mode::OS || mode == Mode::LS)
@@ -176,26 +256,21 @@ void recalculate_MRSP()
         restrictions.push_back(*STM_max_speed);
     if (override_speed && (mode == Mode::SH || mode == Mode::SR || mode == Mode::UN))
         restrictions.push_back(*override_speed);
-    if (mode == Mode::FS || mode == Mode::OS || mode == Mode::LS)
-        restrictions.insert(restrictions.begin(), signal_speeds.begin(), signal_speeds.end());
     if (restrictions.empty()) {
         set_supervised_targets();
         return;
     }
-    std::set<relocable_dist_base> critical_points;
-    for (auto it = restrictions.begin(); it != restrictions.end(); ++it) {
-        critical_points.insert(it->get().get_start());
-        critical_points.insert(it->get().get_end());
-    }
-    for (auto it = critical_points.begin(); it != --critical_points.end(); ++it) {
-        double spd=400;
-        for (auto it2 = restrictions.begin(); it2 != restrictions.end(); ++it2) {
-            if (it2->get().get_start()<=*it && it2->get().get_end()>*it && it2->get().get_speed()<spd)
-                spd = it2->get().get_speed();
-        }
-        if (MRSP.size()==0 || (--MRSP.upper_bound(*it))->second!=spd)
-            MRSP[*it] = spd;
+    sweep_MRSP(restrictions);
+#ifdef DEBUG_MRSP_CONSISTENCY
+    auto reference = scan_MRSP(restrictions);
+    bool consistent = reference.size() == MRSP.size();
+    for (auto it = reference.begin(), it2 = MRSP.begin(); consistent && it != reference.end(); ++it, ++it2) {
+        if (it->first != it2->first || it->first.get_ref() != it2->first.get_ref() || it->second != it2->second)
+            consistent = false;
     }
+    if (!consistent)
+        platform->debug_print("MRSP mismatch: sweep produced " + std::to_string(MRSP.size()) + " elements, scan produced " + std::to_string(reference.size()));
+#endif
     set_supervised_targets();
 }
 std::map<relocable_dist_base,double,std::less<>> &get_MRSP()
@@ -258,22 +333,102 @@ void update_gradient(std::vector<std::pair<distance,double>> grad)
     gradient_profile.insert(gradient_profile.end(), prof.begin(), prof.end());
     recalculate_gradient();
 }
+static optional<profile_change> gradient_changes;
+static unsigned gradient_version = 0;
+static void add_gradient_changes(const std::map<dist_base, double> &prev, const std::map<dist_base, double> &next)
+{
+    // Walk the breakpoints of both profiles. A difference at one breakpoint
+    // extends up to the following breakpoint of either profile.
+    optional<dist_base> start;
+    optional<dist_base> end;
+    bool open = false;
+    auto it1 = prev.begin();
+    auto it2 = next.begin();
+    while (it1 != prev.end() || it2 != next.end()) {
+        dist_base d;
+        bool differs;
+        if (it2 == next.end() || (it1 != prev.end() && it1->first < it2->first)) {
+            d = it1->first;
+            differs = true;
+            ++it1;
+        } else if (it1 == prev.end() || it2->first < it1->first) {
+            d = it2->first;
+            differs = true;
+            ++it2;
+        } else {
+            d = it1->first;
+            differs = it1->second != it2->second;
+            ++it1;
+            ++it2;
+        }
+        if (open) {
+            end = d;
+            open = false;
+        }
+        if (differs) {
+            if (!start)
+                start = d;
+            open = true;
+        }
+    }
+    if (!start)
+        return;
+    gradient_version++;
+    if (open)
+        end = dist_base::max;
+    if (gradient_changes) {
+        gradient_changes->start = std::min(gradient_changes->start, *start);
+        gradient_changes->end = std::max(gradient_changes->end, *end);
+    } else {
+        gradient_changes = profile_change({*start, *end});
+    }
+}
 void recalculate_gradient()
 {
-    gradient.clear();
-    std::set<dist_base> critical_points;
+    gradient_profile_changed = false;
+    std::vector<dist_base> points;
+    points.reserve(2*gradient_profile.size());
+    std::vector<double> grads;
+    grads.reserve(gradient_profile.size());
     for (auto it = gradient_profile.begin(); it != gradient_profile.end(); ++it) {
-        critical_points.insert(it->start.max);
-        critical_points.insert(it->end.min);
+        points.push_back(it->start.max);
+        points.push_back(it->end.min);
+        grads.push_back(it->grad);
     }
-    for (auto &d : critical_points) {
-        double grad = 1000;
-        for (auto it = gradient_profile.begin(); it != gradient_profile.end(); ++it) {
-            if (it->start.max <= d && it->end.min > d && it->grad < grad)
-                grad = it->grad;
+    std::vector<size_t> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&points](size_t a, size_t b) {
+        return points[a] < points[b];
+    });
+    std::map<dist_base, double> grad;
+    std::multiset<double> active;
+    for (size_t i = 0; i < order.size(); ) {
+        const dist_base &point = points[order[i]];
+        size_t j = i;
+        for (; j < order.size() && !(point < points[order[j]]); ++j) {
+            size_t e = order[j]/2;
+            if (!(points[2*e] < points[2*e+1]))
+                continue;
+            if (order[j] % 2 == 0)
+                active.insert(grads[e]);
+            else
+                active.erase(active.find(grads[e]));
         }
-        gradient[d] = grad;
+        grad.emplace_hint(grad.end(), point, active.empty() ? 1000 : std::min(1000.0, *active.begin()));
+        i = j;
     }
+    add_gradient_changes(gradient, grad);
+    gradient = std::move(grad);
+}
+optional<profile_change> consume_gradient_changes()
+{
+    optional<profile_change> changes = gradient_changes;
+    gradient_changes = {};
+    return changes;
+}
+unsigned get_gradient_version()
+{
+    return gradient_version;
 }
 const std::map<dist_base, double> &get_gradient()
 {
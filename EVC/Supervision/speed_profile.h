@@ -90,6 +90,15 @@ dist_base SSP_end();
 void update_ASP(distance start, std::vector<speed_restriction> &nASP);
 void update_gradient(std::vector<std::pair<distance,double>> grad);
 const std::map<dist_base, double> &get_gradient();
+struct profile_change
+{
+    dist_base start;
+    dist_base end;
+};
+// Interval where the gradient changed since the previous call
+optional<profile_change> consume_gradient_changes();
+// Incremented whenever the gradient profile changes
+unsigned get_gradient_version();
 extern int default_gradient_tsr;
 struct TSR
 {
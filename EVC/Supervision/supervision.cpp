@@ -92,7 +92,7 @@ dist_base get_d_startRSM(double V_release)
     }
     int alpha = level==Level::N1;
     auto conf = confidence_data::from_distance(d_EoA.est);
-    dist_base d_tripEoA = d_EoA.min+alpha*L_antenna_front + std::max(2*conf.locacc+10+(d_EoA.est - d_EoA.est.ref)/10,d_maxsafefront(d_EoA)-d_minsafefront(d_EoA));
+    dist_base d_tripEoA = d_EoA.min+alpha*L_antenna_front + std::max(2*conf.locacc+10+(d_EoA.est - d_EoA.est.get_ref())/10,d_maxsafefront(d_EoA)-d_minsafefront(d_EoA));
     
     dist_base d_startRSM;
     
@@ -136,7 +136,7 @@ double calculate_V_release()
     const std::list<std::shared_ptr<target>> &supervised_targets = get_supervised_targets();
     int alpha = level==Level::N1;
     auto conf = confidence_data::from_distance(d_EoA.est);
-    dist_base d_tripEoA = d_EoA.min+alpha*L_antenna_front + std::max(2*conf.locacc+10+(d_EoA.est-d_EoA.est.ref)/10,d_maxsafefront(d_EoA)-d_minsafefront(d_EoA));
+    dist_base d_tripEoA = d_EoA.min+alpha*L_antenna_front + std::max(2*conf.locacc+10+(d_EoA.est-d_EoA.est.get_ref())/10,d_maxsafefront(d_EoA)-d_minsafefront(d_EoA));
     double V_release = calc_ceiling_limit(d_EoA.est, d_SvL.max);
     std::list<std::shared_ptr<target>> candidates;
     std::shared_ptr<target> tSvL;
@@ -21,6 +21,9 @@
 #include "../TrainSubsystems/train_interface.h"
 #include "../TrainSubsystems/power.h"
 #include <set>
+#ifdef DEBUG_BRAKING_CURVE_TABLES
+#include "platform_runtime.h"
+#endif
 std::list<std::shared_ptr<PBD_target>> PBDs;
 target::target(relocable_dist_base dist, double speed, target_class type, bool is_TSR) : basic_target(dist, speed, type, is_TSR)
 {
@@ -48,47 +51,93 @@ dist_base target::get_distance_curve(double velocity) const
     }*/
     if (is_EBD_based) {
         if (type == target_class::SvL || type == target_class::SR_distance || type == target_class::PBD)
-            return distance_curve(A_safe, d_target, 0, velocity);
+            return curve_distance(ebd_curve, decelerations->A_safe, d_target, 0, velocity);
         else
-            return distance_curve(A_safe, d_target, V_target+dV_ebi(V_target), velocity);
+            return curve_distance(ebd_curve, decelerations->A_safe, d_target, V_target+dV_ebi(V_target), velocity);
     } else {
-        return distance_curve(A_expected, d_target, 0, velocity);
+        return curve_distance(ebd_curve, decelerations->A_expected, d_target, 0, velocity);
     }
 }
 double target::get_speed_curve(dist_base dist) const
 {
     if (is_EBD_based) {
         if (type == target_class::SvL || type == target_class::SR_distance || type == target_class::PBD)
-            return speed_curve(A_safe, d_target, 0, dist);
+            return curve_speed(ebd_curve, decelerations->A_safe, d_target, 0, dist);
         else
-            return speed_curve(A_safe, d_target, V_target+dV_ebi(V_target), dist);
+            return curve_speed(ebd_curve, decelerations->A_safe, d_target, V_target+dV_ebi(V_target), dist);
     } else {
-        return speed_curve(A_expected, d_target, 0, dist);
+        return curve_speed(ebd_curve, decelerations->A_expected, d_target, 0, dist);
     }
 }
-dist_base target::get_distance_gui_curve(double velocity) const
+dist_base target::get_gui_foot(gui_foot_cache &cache, double V_delta0t) const
 {
-    dist_base guifoot;
-    if (type == target_class::EoA || type == target_class::SvL) {
-        guifoot = d_target;
-    } else {
-        double V_delta0t = 0;
+    if (type == target_class::EoA || type == target_class::SvL)
+        return d_target;
+    if (cache.model != decelerations || cache.d_target != d_target.get().dist || cache.T_berem != T_berem || cache.T_traction != T_traction || cache.T_bs2 != T_bs2) {
+        cache.model = decelerations;
+        cache.d_target = d_target.get().dist;
+        cache.T_berem = T_berem;
+        cache.T_traction = T_traction;
+        cache.T_bs2 = T_bs2;
         dist_base debi = get_distance_curve(V_target+V_delta0t)-(V_target+V_delta0t)*(T_berem+T_traction);
-        guifoot = debi-V_target*(T_driver+T_bs2);
+        cache.foot = debi-V_target*(T_driver+T_bs2);
     }
-    return distance_curve(A_normal_service, guifoot, V_target, velocity);
+    return cache.foot;
+}
+dist_base target::get_distance_gui_curve(double velocity) const
+{
+    dist_base guifoot = get_gui_foot(gui_foot[0], 0);
+    return curve_distance(gui_curve[0], decelerations->A_normal_service, guifoot, V_target, velocity);
 }
 double target::get_speed_gui_curve(dist_base dist) const
 {
-    dist_base guifoot;
-    if (type == target_class::EoA || type == target_class::SvL) {
-        guifoot = d_target;
-    } else {
-        double V_delta0t = 0.007*V_target;
-        dist_base debi = get_distance_curve(V_target+V_delta0t)-(V_target+V_delta0t)*(T_berem+T_traction);
-        guifoot = debi-V_target*(T_driver+T_bs2);
+    dist_base guifoot = get_gui_foot(gui_foot[1], 0.007*V_target);
+    return curve_speed(gui_curve[1], decelerations->A_normal_service, guifoot, V_target, dist);
+}
+#ifdef BRAKING_CURVE_TABLES
+static const curve_table &get_curve_table(const std::shared_ptr<const deceleration_model> &model, curve_cache &cache, const acceleration &a, const dist_base &dref, double vref)
+{
+    if (cache.model != model || cache.source != &a || cache.dref.dist != dref.dist || cache.dref.orientation != dref.orientation || cache.vref != vref) {
+        cache.model = model;
+        cache.source = &a;
+        cache.dref = dref;
+        cache.vref = vref;
+        cache.table = curve_table(a, dref, vref);
+    }
+    return cache.table;
+}
+#endif
+dist_base target::curve_distance(curve_cache &cache, const acceleration &a, const dist_base &dref, double vref, double velocity) const
+{
+#ifdef BRAKING_CURVE_TABLES
+    const curve_table &table = get_curve_table(decelerations, cache, a, dref, vref);
+    if (table.valid) {
+        dist_base d = table.distance(velocity);
+#ifdef DEBUG_BRAKING_CURVE_TABLES
+        dist_base exact = distance_curve(a, dref, vref, velocity);
+        if (std::abs(d-exact) > 0.01)
+            platform->debug_print("Braking curve table mismatch: distance for "+std::to_string(velocity)+" is "+std::to_string(d.dist)+", expected "+std::to_string(exact.dist));
+#endif
+        return d;
     }
-    return speed_curve(A_normal_service, guifoot, V_target, dist);
+#endif
+    return distance_curve(a, dref, vref, velocity);
+}
+double target::curve_speed(curve_cache &cache, const acceleration &a, const dist_base &dref, double vref, dist_base dist) const
+{
+#ifdef BRAKING_CURVE_TABLES
+    const curve_table &table = get_curve_table(decelerations, cache, a, dref, vref);
+    if (table.valid) {
+        double v = table.speed(dist);
+#ifdef DEBUG_BRAKING_CURVE_TABLES
+        double exact = speed_curve(a, dref, vref, dist);
+        if (std::abs(v-exact) > 0.01)
+            platform->debug_print("Braking curve table mismatch: speed at "+std::to_string(dist.dist)+" is "+std::to_string(v)+", expected "+std::to_string(exact));
+#endif
+        return v;
+    }
+#endif
+    return speed_curve(a, dref, vref, dist);
 }
 void target::calculate_times() const
 {
@@ -178,15 +227,76 @@ optional<double> SR_dist_override;
 optional<double> SR_speed_override;
 optional<std::pair<distance,double>> LoA;
 double V_releaseSvL=0;
+struct deceleration_inputs
+{
+    unsigned brake_model;
+    std::map<dist_base,std::pair<int,int>> combination;
+    double L_TRAIN;
+    double M_rotating_nom;
+    brake_position_types brake_position;
+    bool additional_brake;
+    bool slippery_rail;
+    int default_gradient_tsr;
+    bool operator==(const deceleration_inputs &o) const
+    {
+        return brake_model == o.brake_model && combination == o.combination && L_TRAIN == o.L_TRAIN &&
+            M_rotating_nom == o.M_rotating_nom && brake_position == o.brake_position &&
+            additional_brake == o.additional_brake && slippery_rail == o.slippery_rail && default_gradient_tsr == o.default_gradient_tsr;
+    }
+};
+static deceleration_inputs get_deceleration_inputs()
+{
+    return {brake_model_version, active_combination, L_TRAIN, M_rotating_nom, brake_position, additional_brake_available, slippery_rail_driver, default_gradient_tsr};
+}
 static std::list<std::shared_ptr<target>> supervised_targets;
 bool changed = false;
 void recalculate_all_decelerations();
+static optional<deceleration_inputs> supervised_inputs;
+static bool overlaps_curves(const target &t, const profile_change &change)
+{
+    // Gradient changes entirely behind the train, such as deleted back
+    // information, are never evaluated by the braking curves
+    if (change.end + L_TRAIN < d_minsafefront(confidence_data::basic()))
+        return false;
+    // Curves of targets with a non-zero speed are evaluated slightly beyond
+    // the target, up to the point where the EBD reaches the target speed
+    dist_base curve_end = t.get_target_position();
+    if (t.is_EBD_based && t.get_target_speed() > 0)
+        curve_end = t.get_distance_curve(t.get_target_speed());
+    return change.start <= curve_end;
+}
 void set_supervised_targets()
 {
     update_brake_contributions();
     changed = true;
     indication_target = nullptr;
-    supervised_targets.clear();
+    // Targets whose braking curves are not affected by the changes are kept,
+    // so that their deceleration models are not computed again
+    std::list<std::shared_ptr<target>> previous;
+    previous.swap(supervised_targets);
+    auto gradient_changes = consume_gradient_changes();
+    deceleration_inputs inputs = get_deceleration_inputs();
+    if (!supervised_inputs || !(*supervised_inputs == inputs))
+        previous.clear();
+    supervised_inputs = inputs;
+    // The reference and the relocation group decide the confidence interval
+    // and how the target moves, so they must match as well as the distance
+    auto same_location = [](const relocable_dist_base &a, const relocable_dist_base &b) {
+        return a.get_group() == b.get_group() && a.get() == b.get() && a.orientation == b.orientation && a.get_ref().dist == b.get_ref().dist && a.balise_based == b.balise_based;
+    };
+    auto get_target = [&previous, &same_location, &gradient_changes](const relocable_dist_base &dist, double speed, target_class type, bool is_TSR) {
+        for (auto it = previous.begin(); it != previous.end(); ++it) {
+            const target &t = **it;
+            if (t.type == type && t.is_TSR == is_TSR && t.get_target_speed() == speed && same_location(t.get_target_position(), dist)) {
+                if (gradient_changes && overlaps_curves(t, *gradient_changes))
+                    break;
+                auto reused = *it;
+                previous.erase(it);
+                return reused;
+            }
+        }
+        return std::make_shared<target>(dist, speed, type, is_TSR);
+    };
     if (mode != Mode::SR && mode != Mode::UN && mode != Mode::FS && mode != Mode::OS && mode != Mode::LS) return;
     auto &MRSP = get_MRSP();
     if (!MRSP.empty()) {
@@ -201,19 +311,18 @@ void set_supervised_targets()
                         break;
                     }
                 }
-                auto t = std::make_shared<target>(it->first, it->second, target_class::MRSP, is_TSR);
-                supervised_targets.push_back(t);
+                supervised_targets.push_back(get_target(it->first, it->second, target_class::MRSP, is_TSR));
             }
             prev = it;
         }
     }
     if (mode == Mode::FS || mode == Mode::OS || mode == Mode::LS) {
         if (SvL)
-            supervised_targets.push_back(std::make_shared<target>(SvL->max, 0, target_class::SvL));
+            supervised_targets.push_back(get_target(SvL->max, 0, target_class::SvL, false));
         if (EoA)
-            supervised_targets.push_back(std::make_shared<target>(EoA->est, 0, target_class::EoA));
+            supervised_targets.push_back(get_target(EoA->est, 0, target_class::EoA, false));
         if (LoA)
-            supervised_targets.push_back(std::make_shared<target>(LoA->first.max, LoA->second, target_class::LoA));
+            supervised_targets.push_back(get_target(LoA->first.max, LoA->second, target_class::LoA, false));
     }
     SR_dist = {};
     if (mode == Mode::SR && SR_dist_start) {
@@ -223,9 +332,10 @@ void set_supervised_targets()
         if (std::isfinite(D_STFF))
             SR_dist = *SR_dist_start + D_STFF;
         if (SR_dist)
-            supervised_targets.push_back(std::make_shared<target>(SR_dist->max, 0, target_class::SR_distance));
+            supervised_targets.push_back(get_target(SR_dist->max, 0, target_class::SR_distance, false));
     }
-    target::recalculate_all_decelerations();
+    // Track condition targets were already updated by update_brake_contributions()
+    calculate_perturbation_location();
 }
 bool supervised_targets_changed()
 {
@@ -248,12 +358,12 @@ const std::list<std::shared_ptr<target>> &get_supervised_targets()
 {
     return supervised_targets;
 }
-void target::calculate_decelerations()
-{
-    calculate_decelerations(get_gradient());
-}
-void target::calculate_decelerations(const std::map<dist_base,double> &gradient)
+static std::shared_ptr<deceleration_model> build_deceleration_model(const std::map<dist_base,double> &gradient, double default_gradient, bool use_brake_combination)
 {
+    auto model = std::make_shared<deceleration_model>();
+    acceleration &A_safe = model->A_safe;
+    acceleration &A_expected = model->A_expected;
+    acceleration &A_normal_service = model->A_normal_service;
     std::map<dist_base,bool> redadh;
     redadh[dist_base(std::numeric_limits<double>::lowest(), 0)] = false;
     acceleration A_gradient = get_A_gradient(gradient, default_gradient);
@@ -262,54 +372,89 @@ void target::calculate_decelerations(const std::map<dist_base,double> &gradient)
     acceleration A_brake_normal_service = get_A_brake_normal_service(A_brake_service);
     acceleration A_brake_safe;
     if (conversion_model_used) {
-        A_brake_safe = A_brake_emergency;
+        std::vector<double> speeds = A_brake_emergency.speed_step;
         for (auto it=Kv_int.begin(); it!=Kv_int.end(); ++it)
-            A_brake_safe.speed_step.insert(it->first);
-
-        for (auto &d : A_brake_safe.dist_step) {
-            for (auto &V : A_brake_safe.speed_step) {
-                A_brake_safe.accelerations[d][V] = (--Kv_int.upper_bound(V))->second*(--Kr_int.upper_bound(L_TRAIN))->second*A_brake_emergency(V,d);
-            }
-        }
+            speeds.push_back(it->first);
+        A_brake_safe = acceleration(A_brake_emergency.dist_step, std::move(speeds));
+        double Kr = (--Kr_int.upper_bound(L_TRAIN))->second;
+        A_brake_safe.fill([&A_brake_emergency, Kr](double V, const dist_base &d) {
+            return (--Kv_int.upper_bound(V))->second*Kr*A_brake_emergency(V,d);
+        });
     } else {
         A_brake_safe = A_brake_emergency;
-        for (auto &d : A_brake_safe.dist_step) {
-            for (auto &V : A_brake_safe.speed_step) {
-                double wet = Kwet_rst(V,d);
-                A_brake_safe.accelerations[d][V] = Kdry_rst(V,M_NVEBCL,d)*(wet+M_NVAVADH*(1-wet))*A_brake_emergency(V,d);
-            }
-        }
+        A_brake_safe.fill([&A_brake_emergency](double V, const dist_base &d) {
+            double wet = Kwet_rst(V,d);
+            return Kdry_rst(V,M_NVEBCL,d)*(wet+M_NVAVADH*(1-wet))*A_brake_emergency(V,d);
+        });
     }
 
-    A_safe = A_brake_safe + A_gradient;
+    std::vector<dist_base> dists;
+    dists.reserve(A_brake_safe.dist_step.size()+A_gradient.dist_step.size()+redadh.size());
+    dists.insert(dists.end(), A_brake_safe.dist_step.begin(), A_brake_safe.dist_step.end());
+    dists.insert(dists.end(), A_gradient.dist_step.begin(), A_gradient.dist_step.end());
     for (auto it=redadh.begin(); it!=redadh.end(); ++it)
-        A_safe.dist_step.insert(it->first);
-    for (auto &d : A_safe.dist_step) {
-        for (auto &V : A_safe.speed_step) {
-            bool slip = (--redadh.upper_bound(d))->second || slippery_rail_driver;
-            double A_MAXREDADH = slip ? (brake_position != brake_position_types::PassengerP ? A_NVMAXREDADH3 : (additional_brake_available ? A_NVMAXREDADH2 : A_NVMAXREDADH1)) : -3;
-            if (!slip || A_MAXREDADH < 0)
-                A_MAXREDADH = std::numeric_limits<double>::max();
-            A_safe.accelerations[d][V] =  std::min(A_brake_safe(V,d), A_MAXREDADH) + A_gradient(V,d);
-        }
-    }
+        dists.push_back(it->first);
+    std::vector<double> speeds = A_brake_safe.speed_step;
+    speeds.insert(speeds.end(), A_gradient.speed_step.begin(), A_gradient.speed_step.end());
+    A_safe = acceleration(std::move(dists), std::move(speeds));
+    A_safe.fill([&redadh, &A_brake_safe, &A_gradient](double V, const dist_base &d) {
+        bool slip = (--redadh.upper_bound(d))->second || slippery_rail_driver;
+        double A_MAXREDADH = slip ? (brake_position != brake_position_types::PassengerP ? A_NVMAXREDADH3 : (additional_brake_available ? A_NVMAXREDADH2 : A_NVMAXREDADH1)) : -3;
+        if (!slip || A_MAXREDADH < 0)
+            A_MAXREDADH = std::numeric_limits<double>::max();
+        return std::min(A_brake_safe(V,d), A_MAXREDADH) + A_gradient(V,d);
+    });
         
     A_expected = A_brake_service + A_gradient;
     
-    A_normal_service = A_brake_normal_service + A_gradient;
     if (!Kn[0].empty() && !Kn[1].empty()) {
+        std::vector<dist_base> dists = A_brake_normal_service.dist_step;
+        dists.insert(dists.end(), A_gradient.dist_step.begin(), A_gradient.dist_step.end());
+        std::vector<double> speeds = A_brake_normal_service.speed_step;
+        speeds.insert(speeds.end(), A_gradient.speed_step.begin(), A_gradient.speed_step.end());
         for (auto it=Kn[0].begin(); it!=Kn[0].end(); ++it)
-            A_normal_service.speed_step.insert(it->first);
+            speeds.push_back(it->first);
         for (auto it=Kn[1].begin(); it!=Kn[1].end(); ++it)
-            A_normal_service.speed_step.insert(it->first);
-        for (auto &d : A_normal_service.dist_step) {
-            for (auto &V : A_normal_service.speed_step) {
-                double grad = (gradient.empty() || gradient.begin()->first > d) ? default_gradient : (--gradient.upper_bound(d))->second;
-                double kn = (grad > 0) ? (--Kn[0].upper_bound(V))->second : (--Kn[1].upper_bound(V))->second;
-                A_normal_service.accelerations[d][V] = A_brake_normal_service(V,d) + A_gradient(V,d) - kn*grad/1000;
-            }
-        }
+            speeds.push_back(it->first);
+        A_normal_service = acceleration(std::move(dists), std::move(speeds));
+        A_normal_service.fill([&gradient, &A_brake_normal_service, &A_gradient, default_gradient](double V, const dist_base &d) {
+            double grad = (gradient.empty() || gradient.begin()->first > d) ? default_gradient : (--gradient.upper_bound(d))->second;
+            double kn = (grad > 0) ? (--Kn[0].upper_bound(V))->second : (--Kn[1].upper_bound(V))->second;
+            return A_brake_normal_service(V,d) + A_gradient(V,d) - kn*grad/1000;
+        });
+    } else {
+        A_normal_service = A_brake_normal_service + A_gradient;
+    }
+    return model;
+}
+struct deceleration_model_key
+{
+    deceleration_inputs inputs;
+    unsigned gradient_version;
+    bool operator==(const deceleration_model_key &o) const
+    {
+        return gradient_version == o.gradient_version && inputs == o.inputs;
     }
+};
+static optional<deceleration_model_key> cached_models_key;
+static std::map<std::pair<double,bool>, std::shared_ptr<const deceleration_model>> cached_models;
+void target::calculate_decelerations()
+{
+    // All targets built with the same inputs share one deceleration model.
+    // The cache is emptied when the gradient or the braking inputs change.
+    deceleration_model_key key = {get_deceleration_inputs(), get_gradient_version()};
+    if (!cached_models_key || !(*cached_models_key == key)) {
+        cached_models.clear();
+        cached_models_key = key;
+    }
+    auto &model = cached_models[{default_gradient, use_brake_combination}];
+    if (!model)
+        model = build_deceleration_model(get_gradient(), default_gradient, use_brake_combination);
+    decelerations = model;
+}
+void target::calculate_decelerations(const std::map<dist_base,double> &gradient)
+{
+    decelerations = build_deceleration_model(gradient, default_gradient, use_brake_combination);
 }
 void target::recalculate_all_decelerations()
 {
@@ -331,7 +476,7 @@ void PBD_target::calculate_restriction()
             float V_delta0PBD = Q_NVINHSMICPERM ? 0 : 0;
             float Dbec = (v_pbd + dV_ebi(v_pbd) + V_delta0PBD)*(T_traction + T_berem);
             dist_base d1 = doffset + Dbec;
-            if (d1 <= d_target && abs(v_pbd+dV_ebi(v_pbd)-(speed_curve(A_safe, d_target, 0, d1)-V_delta0PBD))<=1/3.6) {
+            if (d1 <= d_target && abs(v_pbd+dV_ebi(v_pbd)-(speed_curve(decelerations->A_safe, d_target, 0, d1)-V_delta0PBD))<=1/3.6) {
                 V_PBD = v_pbd;
                 break;
             }
@@ -339,7 +484,7 @@ void PBD_target::calculate_restriction()
             float V_delta0PBD = Q_NVINHSMICPERM ? 0 : 0;
             float Dbec = (v_pbd + dV_sbi(v_pbd) + V_delta0PBD)*(T_traction + T_berem);
             dist_base d1 = doffset + Dbec + (v_pbd + dV_sbi(v_pbd))*T_bs2;
-            if (d1 <= d_target && abs(v_pbd+dV_sbi(v_pbd)-(speed_curve(A_safe, d_target, 0, d1)-V_delta0PBD))<=1/3.6) {
+            if (d1 <= d_target && abs(v_pbd+dV_sbi(v_pbd)-(speed_curve(decelerations->A_safe, d_target, 0, d1)-V_delta0PBD))<=1/3.6) {
                 V_PBD = v_pbd;
                 break;
             }
@@ -349,7 +494,7 @@ void PBD_target::calculate_restriction()
         float V_PBD_SB = 0;
         for (double v_pbd = 0; v_pbd<500/3.6; v_pbd+=0.8/3.6) {
             dist_base d1 = doffset + (v_pbd + dV_sbi(v_pbd))*T_bs1;
-            if (d1 <= d_target && abs(v_pbd+dV_sbi(v_pbd)-(speed_curve(A_expected, d_target, 0, d1)))<=1/3.6) {
+            if (d1 <= d_target && abs(v_pbd+dV_sbi(v_pbd)-(speed_curve(decelerations->A_expected, d_target, 0, d1)))<=1/3.6) {
                 V_PBD_SB = v_pbd;
                 break;
             }
@@ -11,8 +11,10 @@
 #include <vector>
 #include <list>
 #include <variant>
+#include <memory>
 #include "../optional.h"
 #include "acceleration.h"
+#include "curve_calc.h"
 #include "../Position/distance.h"
 #include "supervision.h"
 #include "conversion_model.h"
@@ -25,6 +27,32 @@ enum struct target_class
     SR_distance,
     PBD
 };
+struct deceleration_model
+{
+    acceleration A_safe;
+    acceleration A_expected;
+    acceleration A_normal_service;
+};
+// Curve table together with the inputs it was built from
+struct curve_cache
+{
+    std::shared_ptr<const deceleration_model> model;
+    const acceleration *source = nullptr;
+    dist_base dref;
+    double vref;
+    curve_table table;
+};
+// Foot of the GUI curve, which only moves when the target is relocated or
+// the brake times change, so that the GUI curve tables are kept meanwhile
+struct gui_foot_cache
+{
+    std::shared_ptr<const deceleration_model> model;
+    double d_target = 0;
+    double T_berem = -1;
+    double T_traction = -1;
+    double T_bs2 = -1;
+    dist_base foot;
+};
 class basic_target
 {
 protected:
@@ -50,6 +78,12 @@ class target : public basic_target
 {
 protected:
     bool use_brake_combination = true;
+    mutable curve_cache ebd_curve;
+    mutable curve_cache gui_curve[2];
+    mutable gui_foot_cache gui_foot[2];
+    dist_base get_gui_foot(gui_foot_cache &cache, double V_delta0t) const;
+    dist_base curve_distance(curve_cache &cache, const acceleration &a, const dist_base &dref, double vref, double velocity) const;
+    double curve_speed(curve_cache &cache, const acceleration &a, const dist_base &dref, double vref, dist_base dist) const;
 public:
     double default_gradient=0;
     target(relocable_dist_base dist, double speed, target_class type, bool is_tsr=false);
@@ -66,9 +100,7 @@ public:
     mutable double V_SBI2;
     mutable double V_SBI1;
     mutable double V_P;
-    mutable acceleration A_safe;
-    mutable acceleration A_expected;
-    mutable acceleration A_normal_service;
+    std::shared_ptr<const deceleration_model> decelerations;
     mutable double A_est1;
     mutable double A_est2;
     mutable double T_traction;
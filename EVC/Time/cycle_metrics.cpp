@@ -0,0 +1,191 @@
+/*
+ * European Train Control System
+ * Copyright (C) 2019-2023  César Benito <cesarbema2009@hotmail.com>
+ * 
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "cycle_metrics.h"
+#ifdef EVC_METRICS
+#include "platform_runtime.h"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+using json = nlohmann::json;
+struct metrics_sample
+{
+    uint32_t id;
+    int64_t ns;
+};
+// Single producer ring buffer with the most recent samples. Subsystems use
+// their index as id, followed by the cycle duration and the period jitter.
+static std::array<metrics_sample, 8192> samples;
+static std::atomic<uint64_t> samples_head;
+static std::vector<subsystem_metrics> subsystems;
+static subsystem_metrics cycle;
+static int64_t period_ns;
+static int64_t last_cycle_start;
+static uint64_t overruns;
+static bool has_scheduler;
+static scheduler_metrics scheduler;
+static std::unique_ptr<BasePlatform::BusSocket> metrics_socket;
+// Number of cycles between two publications
+static const uint64_t publish_cycles = 20;
+int64_t get_cycle_timer_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static void push_sample(uint32_t id, int64_t ns)
+{
+    uint64_t head = samples_head.load(std::memory_order_relaxed);
+    samples[head % samples.size()] = {id, ns};
+    samples_head.store(head + 1, std::memory_order_release);
+}
+void start_cycle_metrics(const std::vector<std::string> &names, int period_ms)
+{
+    subsystems.clear();
+    for (auto &name : names)
+        subsystems.push_back({name, 0, 0, 0});
+    cycle = {"cycle", 0, 0, 0};
+    period_ns = period_ms*1000000LL;
+    last_cycle_start = -1;
+    overruns = 0;
+    has_scheduler = false;
+    samples_head = 0;
+    metrics_socket = platform->open_socket("evc_metrics", BasePlatform::BusSocket::PeerId::fourcc("EVC"));
+}
+static void add_sample(subsystem_metrics &m, int64_t ns)
+{
+    m.count++;
+    m.total_ns += ns;
+    m.max_ns = std::max(m.max_ns, ns);
+}
+void record_cycle_start(int64_t ns)
+{
+    if (last_cycle_start >= 0)
+        push_sample(subsystems.size()+1, std::abs(ns - last_cycle_start - period_ns));
+    last_cycle_start = ns;
+}
+void record_scheduler_metrics(const scheduler_metrics &m)
+{
+    has_scheduler = true;
+    scheduler = m;
+}
+void record_subsystem_time(size_t subsystem, int64_t ns)
+{
+    if (subsystem >= subsystems.size())
+        return;
+    add_sample(subsystems[subsystem], ns);
+    push_sample(subsystem, ns);
+}
+struct sample_stats
+{
+    size_t count = 0;
+    int64_t p50 = 0;
+    int64_t p99 = 0;
+    int64_t max = 0;
+};
+// Per-id values of the ring buffer, kept between calls so that their
+// storage is reused
+static std::vector<std::vector<int64_t>> values;
+static std::vector<sample_stats> compute_stats()
+{
+    values.resize(subsystems.size()+2);
+    for (auto &v : values)
+        v.clear();
+    uint64_t head = samples_head.load(std::memory_order_acquire);
+    uint64_t first = head > samples.size() ? head - samples.size() : 0;
+    for (uint64_t i = first; i < head; i++) {
+        const metrics_sample &s = samples[i % samples.size()];
+        if (s.id < values.size())
+            values[s.id].push_back(s.ns);
+    }
+    std::vector<sample_stats> stats(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        auto &v = values[i];
+        if (v.empty())
+            continue;
+        stats[i].count = v.size();
+        std::nth_element(v.begin(), v.begin() + v.size()/2, v.end());
+        stats[i].p50 = v[v.size()/2];
+        std::nth_element(v.begin(), v.begin() + (v.size()*99)/100, v.end());
+        stats[i].p99 = v[(v.size()*99)/100];
+        stats[i].max = *std::max_element(v.begin(), v.end());
+    }
+    return stats;
+}
+static json stats_to_json(const std::string &name, const sample_stats &s)
+{
+    return json{{"name", name}, {"count", s.count}, {"p50_us", s.p50/1000.0}, {"p99_us", s.p99/1000.0}, {"max_us", s.max/1000.0}};
+}
+static json stats_to_json(const subsystem_metrics &m, const sample_stats &s)
+{
+    json j = stats_to_json(m.name, s);
+    j["calls"] = m.count;
+    j["total_ms"] = m.total_ns/1e6;
+    j["mean_us"] = m.count > 0 ? m.total_ns/1000.0/m.count : 0;
+    j["run_max_us"] = m.max_ns/1000.0;
+    return j;
+}
+static void publish_metrics()
+{
+    if (!metrics_socket)
+        return;
+    auto stats = compute_stats();
+    json j;
+    j["time"] = platform->get_timer();
+    j["cycles"] = cycle.count;
+    j["overruns"] = overruns;
+    json &subs = j["subsystems"] = json::array();
+    for (size_t i = 0; i < subsystems.size(); i++)
+        subs.push_back(stats_to_json(subsystems[i], stats[i]));
+    j["cycle"] = stats_to_json(cycle, stats[subsystems.size()]);
+    j["jitter"] = stats_to_json("jitter", stats[subsystems.size()+1]);
+    if (has_scheduler) {
+        j["scheduler"] = json{{"cycles", scheduler.cycles}, {"overruns", scheduler.overruns}, {"skipped", scheduler.skipped},
+            {"last_jitter_us", scheduler.last_jitter_us}, {"max_jitter_us", scheduler.max_jitter_us},
+            {"mean_jitter_us", scheduler.cycles > 0 ? (double)scheduler.total_jitter_us/scheduler.cycles : 0}};
+    }
+    metrics_socket->broadcast(j.dump());
+}
+void record_cycle_time(int64_t ns)
+{
+    add_sample(cycle, ns);
+    push_sample(subsystems.size(), ns);
+    if (ns > period_ns)
+        overruns++;
+    if (cycle.count % publish_cycles == 0)
+        publish_metrics();
+}
+static std::string format_metrics(const subsystem_metrics &m, const sample_stats &s)
+{
+    char line[200];
+    double mean = m.count > 0 ? m.total_ns/1000.0/m.count : 0;
+    double share = cycle.total_ns > 0 ? 100.0*m.total_ns/cycle.total_ns : 0;
+    snprintf(line, sizeof(line), "%-36s %10llu %12.3f %10.1f %10.1f %10.1f %10.1f %6.1f%%\n", m.name.c_str(), (unsigned long long)m.count, m.total_ns/1e6, mean, s.p50/1000.0, s.p99/1000.0, m.max_ns/1000.0, share);
+    return line;
+}
+std::string get_cycle_report()
+{
+    auto stats = compute_stats();
+    char line[200];
+    snprintf(line, sizeof(line), "%-36s %10s %12s %10s %10s %10s %10s %7s\n", "subsystem", "calls", "total ms", "mean us", "p50 us", "p99 us", "max us", "share");
+    std::string report = line;
+    for (size_t i = 0; i < subsystems.size(); i++)
+        report += format_metrics(subsystems[i], stats[i]);
+    report += format_metrics(cycle, stats[subsystems.size()]);
+    const sample_stats &jitter = stats[subsystems.size()+1];
+    snprintf(line, sizeof(line), "Period jitter p50 %.1f us, p99 %.1f us, max %.1f us, %llu overruns\n", jitter.p50/1000.0, jitter.p99/1000.0, jitter.max/1000.0, (unsigned long long)overruns);
+    report += line;
+    if (has_scheduler) {
+        double mean = scheduler.cycles > 0 ? (double)scheduler.total_jitter_us/scheduler.cycles : 0;
+        snprintf(line, sizeof(line), "Scheduler jitter mean %.1f us, max %lld us, %llu overruns, %llu skipped cycles\n", mean, (long long)scheduler.max_jitter_us, (unsigned long long)scheduler.overruns, (unsigned long long)scheduler.skipped);
+        report += line;
+    }
+    return report;
+}
+#endif
@@ -0,0 +1,41 @@
+/*
+ * European Train Control System
+ * Copyright (C) 2019-2023  César Benito <cesarbema2009@hotmail.com>
+ * 
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+#ifdef EVC_METRICS
+#include <cstdint>
+#include <string>
+#include <vector>
+struct subsystem_metrics
+{
+    std::string name;
+    uint64_t count;
+    int64_t total_ns;
+    int64_t max_ns;
+};
+// Figures reported by the fixed rate scheduler, when in use
+struct scheduler_metrics
+{
+    uint64_t cycles;
+    uint64_t overruns;
+    uint64_t skipped;
+    int64_t last_jitter_us;
+    int64_t max_jitter_us;
+    int64_t total_jitter_us;
+};
+// Monotonic time in nanoseconds, measured on the host even when the
+// platform clock is virtual
+int64_t get_cycle_timer_ns();
+void start_cycle_metrics(const std::vector<std::string> &subsystems, int period_ms);
+void record_cycle_start(int64_t ns);
+void record_subsystem_time(size_t subsystem, int64_t ns);
+void record_cycle_time(int64_t ns);
+void record_scheduler_metrics(const scheduler_metrics &m);
+// Totals cover the whole run, percentiles only the most recent samples
+std::string get_cycle_report();
+#endif
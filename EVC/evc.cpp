@@ -30,24 +30,98 @@
 #include "LX/level_crossing.h"
 #include "STM/stm.h"
 #include "Euroradio/terminal.h"
+#include "Time/cycle_metrics.h"
 #include "platform_runtime.h"
 
 #include <random>
 
-#ifdef RADIO_CFM
+#if RADIO_CFM && !defined(EVC_REPLAY)
 #include "../EVC/Euroradio/tcp_cfm.h"
 #include "console_platform.h"
 #endif
+#if FIXED_RATE_CYCLE && !defined(EVC_REPLAY)
+#include "console_platform.h"
+#endif
 
 void update();
+static void send_pending_messages()
+{
+    for (auto *session : active_sessions) {
+        session->send_pending();
+    }
+}
+struct subsystem
+{
+    const char *name;
+    void (*update)();
+    // With the fixed-rate scheduler, number of cycles between two runs
+    int divider;
+};
+#ifndef SEND_PENDING_DIVIDER
+#define SEND_PENDING_DIVIDER 1
+#endif
+static const subsystem subsystems[] = {
+    {"update_or_iface", update_or_iface, 1},
+    {"update_clock", update_clock, 1},
+    {"update_odometer", update_odometer, 1},
+    {"update_geographical_position", update_geographical_position, 1},
+    {"update_track_comm", update_track_comm, 1},
+    {"update_national_values", update_national_values, 1},
+    {"update_procedures", update_procedures, 1},
+    {"update_stm_control", update_stm_control, 1},
+    {"update_lx", update_lx, 1},
+    {"update_track_conditions", update_track_conditions, 1},
+    {"update_supervision", update_supervision, 1},
+    {"update_dmi_kinematics", update_dmi_kinematics, 1},
+    {"update_messages", update_messages, 1},
+    {"update_national_functions", update_national_functions, 1},
+    {"update_train_subsystems", update_train_subsystems, 1},
+    {"update_dmi_windows", update_dmi_windows, 1},
+    {"update_track_ahead_free_request", update_track_ahead_free_request, 1},
+    {"send_pending", send_pending_messages, SEND_PENDING_DIVIDER},
+};
+static bool fixed_rate = false;
+static void run_subsystem(size_t i)
+{
+#ifdef EVC_METRICS
+    int64_t start = get_cycle_timer_ns();
+    subsystems[i].update();
+    record_subsystem_time(i, get_cycle_timer_ns() - start);
+#else
+    subsystems[i].update();
+#endif
+}
+static void run_cycle()
+{
+#ifdef EVC_METRICS
+    int64_t cycle_start = get_cycle_timer_ns();
+#ifdef EVC_REPLAY
+    // Jitter is only meaningful against the virtual clock
+    record_cycle_start(platform->get_timer()*1000000LL);
+#else
+    record_cycle_start(cycle_start);
+#endif
+#endif
+    for (size_t i = 0; i < std::size(subsystems); i++) {
+        // Lower rate subsystems run as phases of the fixed-rate scheduler
+        if (!fixed_rate || subsystems[i].divider == 1)
+            run_subsystem(i);
+    }
+#ifdef EVC_METRICS
+    record_cycle_time(get_cycle_timer_ns() - cycle_start);
+#endif
+}
 
 void on_platform_ready()
 {
-#if RADIO_CFM
+#if RADIO_CFM && !defined(EVC_REPLAY)
     initialize_cfm(dynamic_cast<ConsolePlatform&>(*platform).get_poller());
 #endif
 
     platform->debug_print("Starting European Train Control System...");
+#ifdef DEBUG_BIT_MANIPULATOR
+    fuzz_bit_manipulator(10000);
+#endif
     platform->on_quit_request().then([](){
         json odo(odometer_value);
         platform->debug_print(std::to_string(odometer_value));
@@ -55,38 +129,49 @@ void on_platform_ready()
         platform->quit();
     }).detach();
 
+#ifdef EVC_REPLAY
+    // Replays must be deterministic
+    nid_engine = 1;
+#else
     std::random_device rd;
     nid_engine = rd() & 0xFFFFFFUL;
+#endif
 
-    start_dmi();
     start_or_iface();
     start_logging();
     initialize_mode_transitions();
     setup_stm_control();
-    set_message_filters();
     initialize_national_functions();
-    platform->delay(500).then(update).detach();
+#ifdef EVC_METRICS
+    std::vector<std::string> names;
+    for (auto &s : subsystems)
+        names.push_back(s.name);
+    start_cycle_metrics(names, 50);
+#endif
+#if FIXED_RATE_CYCLE && !defined(EVC_REPLAY)
+    if (auto *console = dynamic_cast<ConsolePlatform*>(platform.get())) {
+        fixed_rate = true;
+        console->start_fixed_rate(50, 500, [console]() {
+            run_cycle();
+#ifdef EVC_METRICS
+            auto s = console->get_cycle_stats();
+            record_scheduler_metrics({s.cycles, s.overruns, s.skipped, s.last_jitter_us, s.max_jitter_us, s.total_jitter_us});
+#endif
+        });
+        for (size_t i = 0; i < std::size(subsystems); i++) {
+            if (subsystems[i].divider > 1)
+                console->add_cycle_phase(subsystems[i].divider, [i]() { run_subsystem(i); });
+        }
+        console->add_cycle_phase(2, update_dmi);
+    }
+#endif
+    if (!fixed_rate) {
+        start_dmi();
+        platform->delay(500).then(update).detach();
+    }
 }
 void update()
 {
-    update_or_iface();
-    update_clock();
-    update_odometer();
-    update_geographical_position();
-    update_track_comm();
-    update_national_values();
-    update_procedures();
-    update_stm_control();
-    update_lx();
-    update_track_conditions();
-    update_supervision();
-    update_messages();
-    update_national_functions();
-    update_train_subsystems();
-    update_dmi_windows();
-    update_track_ahead_free_request();
-    for (auto *session : active_sessions) {
-        session->send_pending();
-    }
+    run_cycle();
     platform->delay(50).then(update).detach();
 }
@@ -8,6 +8,8 @@
 #include "platform_runtime.h"
 #include "console_tools.h"
 #include <iostream>
+#include <chrono>
+#include <thread>
 
 #if defined(__unix__) or defined(__APPLE__)
 #include <signal.h>
@@ -86,6 +88,10 @@ ConsolePlatform::ConsolePlatform(const std::vector<std::string> &args) :
 {
 	running = true;
 	quit_request = false;
+	cycle_period_us = 0;
+	cycle_deadline_us = 0;
+	cycle_index = 0;
+	cycle_stats = {};
 #if defined(__unix__) or defined(__APPLE__)
 	quit_request_ptr = &quit_request;
 	signal(SIGTERM, &sigterm_handler);
@@ -155,6 +161,52 @@ ConsoleFdPoller& ConsolePlatform::get_poller() {
 	return poller;
 }
 
+static int64_t get_timer_us() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ConsolePlatform::start_fixed_rate(int period_ms, int delay_ms, std::function<void()> task) {
+	cycle_task = std::move(task);
+	cycle_period_us = period_ms * 1000LL;
+	cycle_deadline_us = get_timer_us() + delay_ms * 1000LL;
+	cycle_index = 0;
+	cycle_stats = {};
+}
+
+void ConsolePlatform::add_cycle_phase(int divider, std::function<void()> task) {
+	cycle_phases.push_back({std::max(divider, 1), std::move(task)});
+}
+
+const ConsolePlatform::CycleStats& ConsolePlatform::get_cycle_stats() const {
+	return cycle_stats;
+}
+
+void ConsolePlatform::run_cycle() {
+	int64_t start = get_timer_us();
+	int64_t jitter = start - cycle_deadline_us;
+	cycle_stats.last_jitter_us = jitter;
+	cycle_stats.max_jitter_us = std::max(cycle_stats.max_jitter_us, jitter);
+	cycle_stats.total_jitter_us += jitter;
+
+	cycle_task();
+	// Phases follow the deadlines, so that skipped cycles do not shift them
+	for (auto &phase : cycle_phases)
+		if (cycle_index % phase.divider == 0)
+			phase.task();
+	cycle_stats.cycles++;
+
+	cycle_index++;
+	cycle_deadline_us += cycle_period_us;
+	int64_t now = get_timer_us();
+	if (now > cycle_deadline_us) {
+		cycle_stats.overruns++;
+		int64_t missed = (now - cycle_deadline_us) / cycle_period_us + 1;
+		cycle_stats.skipped += missed;
+		cycle_index += missed;
+		cycle_deadline_us += missed * cycle_period_us;
+	}
+}
+
 void ConsolePlatform::event_loop() {
 	while (running) {
 		bool idle = true;
@@ -171,6 +223,11 @@ void ConsolePlatform::event_loop() {
 			timer_queue.erase(timer_queue.begin());
 		}
 
+		if (cycle_task && get_timer_us() >= cycle_deadline_us) {
+			idle = false;
+			run_cycle();
+		}
+
 		for (int i = 0; i < 10; i++)
 			if (PlatformUtil::DeferredFulfillment::execute())
 				idle = false;
@@ -180,8 +237,19 @@ void ConsolePlatform::event_loop() {
 		int64_t diff = -1;
 		if (!timer_queue.empty())
 			diff = std::max((int64_t)0, timer_queue.begin()->first - get_timer());
+		int64_t cycle_wait_us = 0;
+		if (cycle_task) {
+			cycle_wait_us = std::max((int64_t)0, cycle_deadline_us - get_timer_us());
+			int64_t cycle_diff = cycle_wait_us / 1000;
+			diff = diff < 0 ? cycle_diff : std::min(diff, cycle_diff);
+		}
 
-		poller.poll(idle ? diff : 0);
+		// Less than a millisecond before the deadline, poll() cannot wait
+		// without overshooting, so sleep for the remainder instead of spinning
+		if (idle && diff == 0 && cycle_wait_us > 0 && cycle_wait_us < 1000)
+			std::this_thread::sleep_for(std::chrono::microseconds(cycle_wait_us));
+		else
+			poller.poll(idle ? diff : 0);
 	};
 
 	on_quit_list.fulfill_all(false);
@@ -21,7 +21,20 @@
 #include "orts_bridge.h"
 
 class ConsolePlatform final : public BasePlatform {
+public:
+	struct CycleStats {
+		uint64_t cycles;
+		uint64_t overruns;
+		uint64_t skipped;
+		int64_t last_jitter_us;
+		int64_t max_jitter_us;
+		int64_t total_jitter_us;
+	};
 private:
+	struct CyclePhase {
+		int divider;
+		std::function<void()> task;
+	};
 	std::string assets_dir;
 	std::string config_dir;
 	std::string storage_dir;
@@ -32,6 +45,16 @@ private:
 	PlatformUtil::FulfillerList<void> on_quit_list;
 	std::multimap<int, PlatformUtil::Fulfiller<void>> timer_queue;
 
+	// Fixed-rate cycle, scheduled against absolute deadlines
+	std::function<void()> cycle_task;
+	std::vector<CyclePhase> cycle_phases;
+	int64_t cycle_period_us;
+	int64_t cycle_deadline_us;
+	// Deadlines elapsed since the start, including the skipped ones
+	uint64_t cycle_index;
+	CycleStats cycle_stats;
+	void run_cycle();
+
 	ConsoleFdPoller poller;
 
 	BusSocketImpl bus_socket_impl;
@@ -49,6 +72,13 @@ public:
 	void event_loop();
 	ConsoleFdPoller& get_poller();
 
+	// Run task every period_ms, starting after delay_ms. Start times do not
+	// drift with the work time, and deadlines missed because of an overrun
+	// are skipped. Phases run after the task every divider cycles.
+	void start_fixed_rate(int period_ms, int delay_ms, std::function<void()> task);
+	void add_cycle_phase(int divider, std::function<void()> task);
+	const CycleStats &get_cycle_stats() const;
+
 	~ConsolePlatform() override;
 
 	int64_t get_timer() override;
@@ -7,3 +7,66 @@
 #include "platform.h"
 
 THREAD_LOCAL_DEF std::vector<std::unique_ptr<PlatformUtil::TypeErasedFulfiller>>* PlatformUtil::DeferredFulfillment::list;
+
+std::shared_ptr<UiPlatform::Image> UiPlatform::get_text_image(const std::string_view text, float ascent, bool bold, const std::string_view lang, float width, int align, Color c)
+{
+	if (text.empty())
+		return nullptr;
+	std::string key;
+	key.reserve(text.size() + lang.size() + 32);
+	key.append(text);
+	key.push_back('\0');
+	key.append(lang);
+	key.push_back('\0');
+	key.append(std::to_string(ascent) + ' ' + std::to_string(width) + ' ' + std::to_string(align));
+	key.push_back(bold ? 'B' : 'R');
+	key.push_back(c.R);
+	key.push_back(c.G);
+	key.push_back(c.B);
+	auto it = text_cache_index.find(key);
+	if (it != text_cache_index.end()) {
+		text_cache_stats.hits++;
+		text_cache.splice(text_cache.begin(), text_cache, it->second);
+		return it->second->image;
+	}
+	text_cache_stats.misses++;
+	std::unique_ptr<Font> font = load_font(ascent, bold, lang);
+	if (!font)
+		return nullptr;
+	std::shared_ptr<Image> image = make_wrapped_text_image(text, *font, width, align, c);
+	if (!image)
+		return nullptr;
+	size_t bytes = image->byte_size();
+	text_cache.push_front({std::move(key), image, bytes});
+	text_cache_index[text_cache.front().key] = text_cache.begin();
+	text_cache_stats.entries++;
+	text_cache_stats.bytes += bytes;
+	trim_text_cache();
+	return image;
+}
+
+void UiPlatform::set_text_cache_limit(size_t bytes)
+{
+	text_cache_limit = bytes;
+	trim_text_cache();
+}
+
+void UiPlatform::clear_text_cache()
+{
+	text_cache_index.clear();
+	text_cache.clear();
+	text_cache_stats.entries = 0;
+	text_cache_stats.bytes = 0;
+}
+
+void UiPlatform::trim_text_cache()
+{
+	// The most recent image is kept even if it exceeds the limit by itself
+	while (text_cache_stats.bytes > text_cache_limit && text_cache.size() > 1) {
+		TextCacheEntry &e = text_cache.back();
+		text_cache_stats.entries--;
+		text_cache_stats.bytes -= e.bytes;
+		text_cache_index.erase(e.key);
+		text_cache.pop_back();
+	}
+}
@@ -9,6 +9,8 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <list>
+#include <unordered_map>
 #include <variant>
 #include <cstdint>
 #include "platform_util.h"
@@ -88,6 +90,12 @@ public:
 	public:
 		virtual ~Image() = default;
 		virtual std::pair<float, float> size() const = 0;
+		// Memory held by the image, estimated from its virtual size by default
+		virtual size_t byte_size() const
+		{
+			auto s = size();
+			return (size_t)(s.first * s.second) * 4;
+		}
 	};
 
 	class Font : private PlatformUtil::NoCopy
@@ -141,6 +149,43 @@ public:
 	virtual std::unique_ptr<Image> make_text_image(const std::string_view text, const Font &font, Color c) = 0;
 	virtual std::unique_ptr<Image> make_wrapped_text_image(const std::string_view text, const Font &font, float width, int align, Color c) = 0;
 
+	// Offscreen layers. Between begin_layer and end_layer, drawing goes into the
+	// layer, whose top-left corner maps to (x, y). Platforms without render targets
+	// return nullptr from create_layer, and callers then draw directly.
+	// begin_layer fails when the layer has been lost and must be created again.
+	virtual std::unique_ptr<Image> create_layer(float w, float h) { return nullptr; }
+	virtual bool begin_layer(Image &layer, float x, float y) { return false; }
+	virtual void end_layer() {}
+
+	// Draws a single line of text with its top-left corner at (x, y). Platforms
+	// with a glyph atlas draw it without rasterising the string, which suits
+	// text that changes often; the others render a new image on every call.
+	virtual bool has_glyph_atlas() const { return false; }
+	virtual void draw_text(const std::string_view text, const Font &font, float x, float y, Color c)
+	{
+		std::unique_ptr<Image> img = make_text_image(text, font, c);
+		if (img)
+			draw_image(*img, x, y);
+	}
+
+	// Text images are cached by content, font, colour, alignment and wrap width.
+	// The least recently used are dropped once the memory held by their
+	// images exceeds the limit.
+	struct TextCacheStats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		size_t entries = 0;
+		size_t bytes = 0;
+	};
+	std::shared_ptr<Image> get_text_image(const std::string_view text, float ascent, bool bold, const std::string_view lang, float width, int align, Color c);
+	void set_text_cache_limit(size_t bytes);
+	void clear_text_cache();
+	const TextCacheStats &get_text_cache_stats() const
+	{
+		return text_cache_stats;
+	}
+
 	virtual void set_volume(int vol) = 0;
 	virtual int get_volume() = 0;
 	virtual std::unique_ptr<SoundData> load_sound(const std::string_view path) = 0;
@@ -151,6 +196,19 @@ public:
 	virtual int get_brightness() = 0;
 
 	virtual PlatformUtil::Promise<InputEvent> on_input_event() = 0;
+
+private:
+	struct TextCacheEntry
+	{
+		std::string key;
+		std::shared_ptr<Image> image;
+		size_t bytes;
+	};
+	std::list<TextCacheEntry> text_cache;
+	std::unordered_map<std::string_view, std::list<TextCacheEntry>::iterator> text_cache_index;
+	size_t text_cache_limit = 16 * 1024 * 1024;
+	TextCacheStats text_cache_stats;
+	void trim_text_cache();
 };
 
 template <>
@@ -0,0 +1,256 @@
+ /*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "replay_platform.h"
+#include "platform_runtime.h"
+#include "console_tools.h"
+#include "../EVC/Packets/io/base64.h"
+#include "../EVC/Time/cycle_metrics.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+// Every allocation of the process is counted, so that the report shows
+// what handling each balise group costs
+static uint64_t allocation_count;
+static std::vector<std::pair<size_t, uint64_t>> balise_group_allocations_list;
+
+void *operator new(size_t size)
+{
+	allocation_count++;
+	void *p = std::malloc(size == 0 ? 1 : size);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+uint64_t get_allocation_count()
+{
+	return allocation_count;
+}
+
+void record_balise_group_allocations(size_t telegrams, uint64_t allocations)
+{
+	balise_group_allocations_list.push_back({telegrams, allocations});
+}
+
+static void print_allocation_report()
+{
+	auto &groups = balise_group_allocations_list;
+	if (groups.empty())
+		return;
+	size_t telegrams = 0;
+	uint64_t total = 0;
+	std::vector<uint64_t> counts;
+	for (auto &g : groups) {
+		telegrams += g.first;
+		total += g.second;
+		counts.push_back(g.second);
+	}
+	std::sort(counts.begin(), counts.end());
+	std::cout << groups.size() << " balise groups, " << telegrams << " telegrams, allocations per group: mean "
+		<< total / groups.size() << ", p50 " << counts[counts.size() / 2] << ", max " << counts.back() << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string recording;
+	int64_t tail = 1000;
+	bool quiet = false;
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg == "-q")
+			quiet = true;
+		else if (arg == "-t" && i + 1 < argc)
+			tail = std::stoll(argv[++i]);
+		else
+			recording = arg;
+	}
+	if (recording.empty()) {
+		std::cerr << "Usage: evc_replay [-q] [-t tail_ms] recording" << std::endl;
+		return 1;
+	}
+	platform = std::make_unique<ReplayPlatform>(recording, tail, quiet);
+	on_platform_ready();
+	auto start = std::chrono::steady_clock::now();
+	static_cast<ReplayPlatform*>(platform.get())->event_loop();
+	auto wall = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Replayed " << platform->get_timer() << " ms in " << wall << " ms" << std::endl;
+#ifdef EVC_METRICS
+	std::cout << get_cycle_report();
+#endif
+	print_allocation_report();
+	return 0;
+}
+
+ReplayPlatform::ReplayPlatform(const std::string &recording, int64_t tail, bool quiet) :
+	assets_dir(get_files_dir(ETCS_ASSET_FILE)),
+	config_dir(get_files_dir(ETCS_CONFIG_FILE)),
+	running(true),
+	quiet(quiet),
+	now(0),
+	end_time(0),
+	next_event(0)
+{
+	PlatformUtil::DeferredFulfillment::list = &event_list;
+	if (!load_recording(recording))
+		debug_print("Failed to load recording " + recording);
+	if (!events.empty())
+		end_time = events.back().time;
+	end_time += tail;
+}
+
+ReplayPlatform::~ReplayPlatform() {
+	on_quit_request_list.clear();
+	on_quit_list.clear();
+	timer_queue.clear();
+	peers.clear();
+	while (PlatformUtil::DeferredFulfillment::execute());
+	PlatformUtil::DeferredFulfillment::list = nullptr;
+}
+
+bool ReplayPlatform::load_recording(const std::string &path) {
+	std::ifstream file(path);
+	if (!file.good())
+		return false;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream ss(line);
+		int64_t time;
+		std::string kind;
+		if (!(ss >> time >> kind))
+			continue;
+		std::string rest;
+		std::getline(ss >> std::ws, rest);
+		if (kind == "sim") {
+			events.push_back({time, "evc_sim", rest});
+		} else if (kind == "telegram") {
+			events.push_back({time, "evc_sim", "etcs::telegram_base64=" + rest});
+		} else if (kind == "radio") {
+			std::istringstream rs(rest);
+			std::string channel, data;
+			rs >> channel >> data;
+			events.push_back({time, channel, base64_decode(data)});
+		}
+	}
+	std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+		return a.time < b.time;
+	});
+	return true;
+}
+
+ReplayPlatform::Peer &ReplayPlatform::get_peer(const std::string_view channel, uint32_t tid) {
+	auto it = peers.find(channel);
+	if (it != peers.end())
+		return it->second;
+	Peer &peer = peers[std::string(channel)];
+	peer.socket = open_socket(channel, tid);
+	drain(peer);
+	return peer;
+}
+
+void ReplayPlatform::drain(Peer &peer) {
+	// Whatever the EVC sends is not part of the replay
+	peer.rx_promise = peer.socket->receive().then([this, &peer](BusSocket::ReceiveResult &&) {
+		drain(peer);
+	});
+}
+
+void ReplayPlatform::event_loop() {
+	get_peer("evc_sim", BusSocket::PeerId::fourcc("SRV"));
+	while (running) {
+		while (PlatformUtil::DeferredFulfillment::execute());
+
+		int64_t next = std::numeric_limits<int64_t>::max();
+		if (!timer_queue.empty())
+			next = timer_queue.begin()->first;
+		if (next_event < events.size())
+			next = std::min(next, events[next_event].time);
+		if (next > end_time)
+			break;
+		now = std::max(now, next);
+
+		while (next_event < events.size() && events[next_event].time <= now) {
+			const Event &ev = events[next_event++];
+			uint32_t tid = ev.channel == "evc_sim" ? BusSocket::PeerId::fourcc("SRV") : BusSocket::PeerId::fourcc("RBC");
+			get_peer(ev.channel, tid).socket->broadcast(ev.data);
+		}
+
+		if (!timer_queue.empty() && timer_queue.begin()->first <= now) {
+			timer_queue.begin()->second.fulfill(false);
+			timer_queue.erase(timer_queue.begin());
+		}
+	}
+
+	on_quit_request_list.fulfill_all(false);
+	while (PlatformUtil::DeferredFulfillment::execute());
+	on_quit_list.fulfill_all(false);
+}
+
+int64_t ReplayPlatform::get_timer() {
+	return now;
+}
+
+std::unique_ptr<BasePlatform::BusSocket> ReplayPlatform::open_socket(const std::string_view channel, uint32_t tid) {
+	auto socket = busses.open_bus_socket(channel, tid);
+	if (socket)
+		return socket;
+	busses.add_bus(channel, LocalBusRouter::create_router());
+	return busses.open_bus_socket(channel, tid);
+}
+
+std::optional<std::string> ReplayPlatform::read_file(const std::string_view path, FileType type) {
+	// Stored data starts empty, so that replays do not depend on previous runs
+	if (type == ETCS_STORAGE_FILE) {
+		auto it = storage.find(path);
+		if (it == storage.end())
+			return std::nullopt;
+		return it->second;
+	}
+	return fstream_file_impl.read_file((type == ETCS_ASSET_FILE ? assets_dir : config_dir) + std::string(path));
+}
+
+bool ReplayPlatform::write_file(const std::string_view path, const std::string_view contents) {
+	storage[std::string(path)] = std::string(contents);
+	return true;
+}
+
+void ReplayPlatform::debug_print(const std::string_view msg) {
+	if (!quiet)
+		std::cout << "[" << now << "] " << msg << std::endl;
+}
+
+PlatformUtil::Promise<void> ReplayPlatform::delay(int ms) {
+	auto pair = PlatformUtil::PromiseFactory::create<void>();
+	timer_queue.insert(std::make_pair(now + ms, std::move(pair.second)));
+	return std::move(pair.first);
+}
+
+PlatformUtil::Promise<void> ReplayPlatform::on_quit_request() {
+	return on_quit_request_list.create_and_add();
+}
+
+PlatformUtil::Promise<void> ReplayPlatform::on_quit() {
+	return on_quit_list.create_and_add();
+}
+
+void ReplayPlatform::quit() {
+	running = false;
+}
@@ -0,0 +1,75 @@
+ /*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <map>
+#include "platform.h"
+#include "local_bus_container.h"
+#include "fstream_file_impl.h"
+
+// Headless platform driven by a recording and a virtual clock.
+// Recordings are text files with one event per line:
+//   <time ms> sim <ORTS line>                 parameter line sent by the simulator
+//   <time ms> telegram <base64>               eurobalise telegram
+//   <time ms> radio <channel> <base64>        data received from an RBC bus
+// Empty lines and lines starting with '#' are ignored.
+class ReplayPlatform final : public BasePlatform {
+private:
+	struct Event {
+		int64_t time;
+		std::string channel;
+		std::string data;
+	};
+	struct Peer {
+		std::unique_ptr<BusSocket> socket;
+		PlatformUtil::Promise<BusSocket::ReceiveResult> rx_promise;
+	};
+
+	std::string assets_dir;
+	std::string config_dir;
+	bool running;
+	bool quiet;
+	int64_t now;
+	int64_t end_time;
+
+	std::vector<Event> events;
+	size_t next_event;
+
+	PlatformUtil::FulfillerList<void> on_quit_request_list;
+	PlatformUtil::FulfillerList<void> on_quit_list;
+	std::multimap<int64_t, PlatformUtil::Fulfiller<void>> timer_queue;
+
+	LocalBusContainer busses;
+	std::map<std::string, Peer, std::less<>> peers;
+	std::map<std::string, std::string, std::less<>> storage;
+	FstreamFileImpl fstream_file_impl;
+
+	std::vector<std::unique_ptr<PlatformUtil::TypeErasedFulfiller>> event_list;
+
+	bool load_recording(const std::string &path);
+	Peer &get_peer(const std::string_view channel, uint32_t tid);
+	void drain(Peer &peer);
+
+public:
+	ReplayPlatform(const std::string &recording, int64_t tail, bool quiet);
+	void event_loop();
+
+	~ReplayPlatform() override;
+
+	int64_t get_timer() override;
+
+	std::unique_ptr<BusSocket> open_socket(const std::string_view channel, uint32_t tid) override;
+	std::optional<std::string> read_file(const std::string_view path, FileType file_type=ETCS_ASSET_FILE) override;
+	bool write_file(const std::string_view path, const std::string_view contents) override;
+	void debug_print(const std::string_view msg) override;
+
+	PlatformUtil::Promise<void> delay(int ms) override;
+	PlatformUtil::Promise<void> on_quit_request() override;
+	PlatformUtil::Promise<void> on_quit() override;
+
+	void quit() override;
+};
@@ -87,6 +87,7 @@ SdlPlatform::SdlPlatform(float virtual_w, float virtual_h, const std::vector<std
 	bool ontop = get_config("alwaysOnTop") == "true";
 	bool hidecursor = get_config("hideCursor") == "true";
 	touch = get_config("touch") == "true";
+	show_draw_calls = get_config("showDrawCalls") == "true";
 	std::string title = get_config("title") == "" ? "SdlPlatform" : get_config("title");
 
 	int flags = 0;
@@ -137,11 +138,13 @@ SdlPlatform::SdlPlatform(float virtual_w, float virtual_h, const std::vector<std
 
 	running = true;
 	present_count = 0;
+	instance = this;
 
 	PlatformUtil::DeferredFulfillment::list = &event_list;
 }
 
 SdlPlatform::~SdlPlatform() {
+	instance = nullptr;
 	timer_queue.clear();
 	on_close_list.clear();
 	on_quit_list.clear();
@@ -150,7 +153,11 @@ SdlPlatform::~SdlPlatform() {
 	while (PlatformUtil::DeferredFulfillment::execute());
 	PlatformUtil::DeferredFulfillment::list = nullptr;
 
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	clear_glyph_atlas();
+#endif
 	loaded_fonts.clear();
+	clear_text_cache();
 	SDL_CloseAudioDevice(audio_device);
 	TTF_Quit();
 	//SDL_DestroyRenderer(sdlrend);
@@ -158,7 +165,10 @@ SdlPlatform::~SdlPlatform() {
 	SDL_Quit();
 }
 
+SdlPlatform *SdlPlatform::instance = nullptr;
+
 void SdlPlatform::calc_scale() {
+	layer_epoch++;
 	SDL_GetRendererOutputSize(sdlrend, &wx, &wy);
 	int px,py;
 	SDL_GetWindowSize(sdlwindow, &px, &py);
@@ -166,6 +176,13 @@ void SdlPlatform::calc_scale() {
 	float sx = wx / virtual_w;
 	float sy = wy / virtual_h;
 	s = std::min(sx, sy);
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	arc_meshes.clear();
+	// Fonts are reloaded at the new scale
+	clear_glyph_atlas();
+#endif
+	// Text images are rasterised at the screen scale
+	clear_text_cache();
 	if (sx > sy) {
 		ox = (wx - wy * (virtual_w / virtual_h)) * 0.5f;
 		oy = 0.0f;
@@ -272,6 +289,14 @@ bool SdlPlatform::poll_sdl() {
 				on_input_list.fulfill_all(ev, false);
 			}
 		}
+		else if (ev.type == SDL_RENDER_TARGETS_RESET || ev.type == SDL_RENDER_DEVICE_RESET)
+		{
+			layer_epoch++;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+			if (ev.type == SDL_RENDER_DEVICE_RESET)
+				clear_glyph_atlas();
+#endif
+		}
         else if (ev.type == SDL_WINDOWEVENT && (ev.window.event == SDL_WINDOWEVENT_RESIZED || ev.window.event == SDL_WINDOWEVENT_SIZE_CHANGED))
 		{
             calc_scale();
@@ -309,6 +334,11 @@ void SdlPlatform::event_loop() {
 		if (present_count > 0) {
 			present_count--;
 			idle = false;
+			flush_batch();
+			if (show_draw_calls)
+				draw_counter_overlay();
+			frame_primitives = 0;
+			frame_draw_calls = 0;
 			SDL_RenderPresent(sdlrend);
 			SDL_SetRenderDrawColor(sdlrend, 0, 0, 0, 255);
 			SDL_RenderClear(sdlrend);
@@ -336,23 +366,150 @@ void SdlPlatform::set_color(Color c) {
 	current_color = c;
 }
 
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+int SdlPlatform::begin_geometry(SDL_Texture *tex) {
+	if (batch_type != BatchType::Geometry || batch_texture != tex) {
+		flush_batch();
+		batch_type = BatchType::Geometry;
+		batch_texture = tex;
+	}
+	return batch_vertices.size();
+}
+#endif
+
+void SdlPlatform::flush_batch() {
+	if (batch_type == BatchType::Rects) {
+		SDL_SetRenderDrawColor(sdlrend, batch_color.R, batch_color.G, batch_color.B, 255);
+		SDL_RenderFillRectsF(sdlrend, batch_rects.data(), batch_rects.size());
+		SDL_SetRenderDrawColor(sdlrend, current_color.R, current_color.G, current_color.B, 255);
+		batch_rects.clear();
+		frame_draw_calls++;
+	}
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	else if (batch_type == BatchType::Geometry) {
+		// Untextured geometry carries its antialiasing in the vertex alpha
+		SDL_BlendMode mode;
+		SDL_GetRenderDrawBlendMode(sdlrend, &mode);
+		if (batch_texture == nullptr)
+			SDL_SetRenderDrawBlendMode(sdlrend, SDL_BLENDMODE_BLEND);
+		if (geometry_failed || SDL_RenderGeometry(sdlrend, batch_texture, batch_vertices.data(), batch_vertices.size(), batch_indices.data(), batch_indices.size()) != 0) {
+			geometry_failed = true;
+			draw_geometry_fallback();
+		}
+		SDL_SetRenderDrawBlendMode(sdlrend, mode);
+		batch_vertices.clear();
+		batch_indices.clear();
+		frame_draw_calls++;
+	}
+#endif
+	batch_type = BatchType::None;
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+void SdlPlatform::draw_geometry_fallback() {
+	if (batch_texture == nullptr) {
+		// Only the opaque triangles are filled, the antialiasing fringes
+		// cannot be drawn by the scanline fill
+		for (size_t i = 0; i + 2 < batch_indices.size(); i += 3) {
+			const SDL_Vertex &a = batch_vertices[batch_indices[i]];
+			const SDL_Vertex &b = batch_vertices[batch_indices[i + 1]];
+			const SDL_Vertex &c = batch_vertices[batch_indices[i + 2]];
+			if (a.color.a != 255 || b.color.a != 255 || c.color.a != 255)
+				continue;
+			int16_t vx[3] = { (int16_t)a.position.x, (int16_t)b.position.x, (int16_t)c.position.x };
+			int16_t vy[3] = { (int16_t)a.position.y, (int16_t)b.position.y, (int16_t)c.position.y };
+			filledPolygonRGBA(sdlrend, vx, vy, 3, a.color.r, a.color.g, a.color.b, 255);
+		}
+		return;
+	}
+	// Textured geometry is only made of quads, from draw_image and draw_text
+	int tw, th;
+	SDL_QueryTexture(batch_texture, nullptr, nullptr, &tw, &th);
+	for (size_t i = 0; i + 5 < batch_indices.size(); i += 6) {
+		const SDL_Vertex &a = batch_vertices[batch_indices[i]];
+		const SDL_Vertex &c = batch_vertices[batch_indices[i + 2]];
+		SDL_FRect dst { std::min(a.position.x, c.position.x), std::min(a.position.y, c.position.y), std::abs(c.position.x - a.position.x), std::abs(c.position.y - a.position.y) };
+		SDL_Rect src { (int)std::lround(std::min(a.tex_coord.x, c.tex_coord.x) * tw), (int)std::lround(std::min(a.tex_coord.y, c.tex_coord.y) * th),
+			(int)std::lround(std::abs(c.tex_coord.x - a.tex_coord.x) * tw), (int)std::lround(std::abs(c.tex_coord.y - a.tex_coord.y) * th) };
+		// Quads of rotated screens map their texture turned by 180 degrees
+		bool rotated = (c.position.x - a.position.x) * (c.tex_coord.x - a.tex_coord.x) < 0;
+		SDL_SetTextureColorMod(batch_texture, a.color.r, a.color.g, a.color.b);
+		SDL_RenderCopyExF(sdlrend, batch_texture, &src, &dst, rotated ? 180.0 : 0.0, nullptr, SDL_FLIP_NONE);
+	}
+	SDL_SetTextureColorMod(batch_texture, 255, 255, 255);
+}
+#endif
+
+void SdlPlatform::release_texture(SDL_Texture *tex) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	if (batch_type == BatchType::Geometry && batch_texture == tex)
+		flush_batch();
+#endif
+}
+
+void SdlPlatform::draw_counter_overlay() {
+	std::unique_ptr<Font> font = load_font(10, false, "");
+	if (!font)
+		return;
+	std::string text = std::to_string(frame_primitives) + " primitives, " + std::to_string(frame_draw_calls) + " draw calls";
+	const TextCacheStats &stats = get_text_cache_stats();
+	if (stats.hits + stats.misses > 0)
+		text += ", text cache " + std::to_string(stats.hits * 100 / (stats.hits + stats.misses)) + "% hits, " + std::to_string(stats.bytes / 1024) + " KiB";
+	std::unique_ptr<Image> img = make_text_image(text, *font, Color{255, 255, 0});
+	if (!img)
+		return;
+	draw_image(*img, 2, 2);
+	flush_batch();
+}
+
 void SdlPlatform::draw_line(float x1, float y1, float x2, float y2) {
+	flush_batch();
+	frame_primitives++;
+	frame_draw_calls++;
 	SDL_RenderDrawLineF(sdlrend, x1 * s + ox, y1 * s + oy, x2 * s + ox, y2 * s + oy);
 }
 
 void SdlPlatform::draw_rect(float x, float y, float w, float h) {
+	flush_batch();
+	frame_primitives++;
+	frame_draw_calls++;
 	SDL_FRect rect { x * s + ox, y * s + oy, w * s, h * s };
 	SDL_RenderDrawRectF(sdlrend, &rect);
 }
 
 void SdlPlatform::draw_rect_filled(float x, float y, float w, float h) {
-	SDL_FRect rect { x * s + ox, y * s + oy, w * s, h * s };
-	SDL_RenderFillRectF(sdlrend, &rect);
+	frame_primitives++;
+	if (batch_type != BatchType::Rects || batch_color.R != current_color.R || batch_color.G != current_color.G || batch_color.B != current_color.B) {
+		flush_batch();
+		batch_type = BatchType::Rects;
+		batch_color = current_color;
+	}
+	batch_rects.push_back({ x * s + ox, y * s + oy, w * s, h * s });
 }
 
 void SdlPlatform::draw_image(const Image &base, float x, float y) {
 	const SdlImage &img = dynamic_cast<const SdlImage&>(base);
 	auto size = img.size();
+	frame_primitives++;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	SDL_FRect rect;
+	if (s > 0.0f)
+		rect = { std::floor(x * s + ox), std::floor(y * s + oy), size.first * s, size.second * s };
+	else
+		rect = { std::floor((x + size.first) * s + ox), std::floor((y + size.second) * s + oy), size.first * -s, size.second * -s };
+	int first = begin_geometry(img.get());
+	// Rotated screens show images turned by 180 degrees
+	float t0 = s > 0.0f ? 0.0f : 1.0f;
+	float t1 = 1.0f - t0;
+	SDL_Color white = { 255, 255, 255, 255 };
+	batch_vertices.push_back({ { rect.x, rect.y }, white, { t0, t0 } });
+	batch_vertices.push_back({ { rect.x + rect.w, rect.y }, white, { t1, t0 } });
+	batch_vertices.push_back({ { rect.x + rect.w, rect.y + rect.h }, white, { t1, t1 } });
+	batch_vertices.push_back({ { rect.x, rect.y + rect.h }, white, { t0, t1 } });
+	batch_indices.insert(batch_indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+#else
+	flush_batch();
+	frame_draw_calls++;
 	if (s > 0.0f) {
 		SDL_FRect rect { std::floor(x * s + ox), std::floor(y * s + oy), size.first * s, size.second * s };
 		SDL_RenderCopyF(sdlrend, img.get(), nullptr, &rect);
@@ -360,15 +517,93 @@ void SdlPlatform::draw_image(const Image &base, float x, float y) {
 		SDL_FRect rect { std::floor((x + size.first) * s + ox), std::floor((y + size.second) * s + oy), size.first * -s, size.second * -s };
 		SDL_RenderCopyExF(sdlrend, img.get(), nullptr, &rect, 180.0, nullptr, SDL_FLIP_NONE);
 	}
+#endif
 }
 
 void SdlPlatform::draw_circle_filled(float x, float y, float r) {
+	flush_batch();
+	frame_primitives++;
+	frame_draw_calls += 2;
 	Color c = current_color;
 	filledCircleRGBA(sdlrend, x * s + ox, y * s + oy, r * s, c.R, c.G, c.B, 255);
 	aacircleRGBA(sdlrend, x * s + ox, y * s + oy, r * s, c.R, c.G, c.B, 255);
 }
 
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+namespace {
+	// Arcs are tessellated at these angles, plus their exact ends
+	const int arc_steps = 180;
+	struct ArcTable {
+		float cos[arc_steps];
+		float sin[arc_steps];
+		ArcTable() {
+			for (int i = 0; i < arc_steps; i++) {
+				double an = 2 * M_PI * i / arc_steps;
+				cos[i] = std::cos(an);
+				sin[i] = std::sin(an);
+			}
+		}
+	};
+	const ArcTable arc_table;
+}
+
+const SdlPlatform::ArcMesh &SdlPlatform::get_arc_mesh(float rmin, float rmax, float ang0, float ang1) {
+	auto key = std::make_tuple(rmin, rmax, ang0, ang1, s);
+	auto it = arc_meshes.find(key);
+	if (it != arc_meshes.end())
+		return it->second;
+	// Speed dependent arcs produce new keys continuously
+	if (arc_meshes.size() >= 256)
+		arc_meshes.clear();
+	ArcMesh &mesh = arc_meshes[key];
+	if (ang0 > ang1)
+		std::swap(ang0, ang1);
+	// Rings at half a pixel on each side of both edges, the outer ones
+	// transparent, so that the curved edges are antialiased
+	float pmin = rmin * std::abs(s);
+	float pmax = rmax * std::abs(s);
+	float pmid = (pmin + pmax) / 2;
+	float radii[4] = { pmin - 0.5f, std::min(pmin + 0.5f, pmid), std::max(pmax - 0.5f, pmid), pmax + 0.5f };
+	uint8_t alpha[4] = { 0, 255, 255, 0 };
+	float sign = s > 0.0f ? 1.0f : -1.0f;
+	auto add_spoke = [&](float c, float sn) {
+		int first = mesh.vertices.size();
+		for (int j = 0; j < 4; j++)
+			mesh.vertices.push_back({ { sign * radii[j] * c, sign * radii[j] * sn }, { 255, 255, 255, alpha[j] }, { 0.0f, 0.0f } });
+		if (first == 0)
+			return;
+		for (int j = 0; j < 3; j++) {
+			int a = first - 4 + j;
+			int b = first + j;
+			mesh.indices.insert(mesh.indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+		}
+	};
+	float step = 2 * M_PI / arc_steps;
+	add_spoke(std::cos(ang0), std::sin(ang0));
+	for (int k = std::floor(ang0 / step) + 1; k * step < ang1; k++) {
+		int i = ((k % arc_steps) + arc_steps) % arc_steps;
+		add_spoke(arc_table.cos[i], arc_table.sin[i]);
+	}
+	add_spoke(std::cos(ang1), std::sin(ang1));
+	return mesh;
+}
+#endif
+
 void SdlPlatform::draw_arc_filled(float cx, float cy, float rmin, float rmax, float ang0, float ang1) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	if (!geometry_failed) {
+		frame_primitives++;
+		const ArcMesh &mesh = get_arc_mesh(rmin, rmax, ang0, ang1);
+		float px = cx * s + ox;
+		float py = cy * s + oy;
+		int first = begin_geometry(nullptr);
+		for (const SDL_Vertex &v : mesh.vertices)
+			batch_vertices.push_back({ { v.position.x + px, v.position.y + py }, { current_color.R, current_color.G, current_color.B, v.color.a }, { 0.0f, 0.0f } });
+		for (int i : mesh.indices)
+			batch_indices.push_back(first + i);
+		return;
+	}
+#endif
     const int n = 51;
     std::vector<std::pair<float, float>> poly;
     poly.resize(2 * n);
@@ -386,6 +621,9 @@ void SdlPlatform::draw_arc_filled(float cx, float cy, float rmin, float rmax, fl
 }
 
 void SdlPlatform::draw_polygon_filled(const std::vector<std::pair<float, float>> &poly) {
+	flush_batch();
+	frame_primitives++;
+	frame_draw_calls += 2;
 	std::vector<int16_t> sx, sy;
 	sx.reserve(poly.size());
 	sy.reserve(poly.size());
@@ -399,6 +637,31 @@ void SdlPlatform::draw_polygon_filled(const std::vector<std::pair<float, float>>
 }
 
 void SdlPlatform::draw_convex_polygon_filled(const std::vector<std::pair<float, float>> &poly) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// Convex polygons are filled as a triangle fan, and only their outline
+	// goes through the antialiased primitives
+	if (poly.size() >= 3 && !geometry_failed) {
+		frame_primitives++;
+		int first = begin_geometry(nullptr);
+		for (size_t i = 0; i < poly.size(); i++) {
+			batch_vertices.push_back({ { poly[i].first * s + ox, poly[i].second * s + oy }, { current_color.R, current_color.G, current_color.B, 255 }, { 0.0f, 0.0f } });
+			if (i >= 2)
+				batch_indices.insert(batch_indices.end(), { first, first + (int)i - 1, first + (int)i });
+		}
+		flush_batch();
+		frame_draw_calls++;
+		std::vector<int16_t> sx, sy;
+		sx.reserve(poly.size());
+		sy.reserve(poly.size());
+		for (const std::pair<float, float> &v : poly) {
+			sx.push_back(v.first * s + ox);
+			sy.push_back(v.second * s + oy);
+		}
+		Color c = current_color;
+		aapolygonRGBA(sdlrend, sx.data(), sy.data(), poly.size(), c.R, c.G, c.B, 255);
+		return;
+	}
+#endif
 	draw_polygon_filled(poly);
 }
 
@@ -544,11 +807,213 @@ std::unique_ptr<SdlPlatform::Image> SdlPlatform::make_wrapped_text_image(const s
 	return img;
 }
 
+std::unique_ptr<SdlPlatform::Image> SdlPlatform::create_layer(float w, float h) {
+	float scale = std::abs(s);
+	int pw = std::ceil(w * scale);
+	int ph = std::ceil(h * scale);
+	if (pw <= 0 || ph <= 0)
+		return nullptr;
+	SDL_Texture *tex = SDL_CreateTexture(sdlrend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, pw, ph);
+	if (tex == nullptr)
+		return nullptr;
+	// Drawing over the cleared layer leaves premultiplied colours. Renderers
+	// without custom blend modes cannot composite it, so no layer is used
+	if (SDL_SetTextureBlendMode(tex, SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+		SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD)) != 0) {
+		SDL_DestroyTexture(tex);
+		return nullptr;
+	}
+	std::unique_ptr<SdlImage> img = std::make_unique<SdlImage>(tex, pw, ph, scale);
+	img->layer_epoch = layer_epoch;
+	return img;
+}
+
+bool SdlPlatform::begin_layer(Image &base, float x, float y) {
+	SdlImage &img = dynamic_cast<SdlImage&>(base);
+	if (in_layer || img.layer_epoch != layer_epoch)
+		return false;
+	flush_batch();
+	if (SDL_SetRenderTarget(sdlrend, img.get()) != 0)
+		return false;
+	in_layer = true;
+	screen_s = s;
+	screen_ox = ox;
+	screen_oy = oy;
+	// Layer pixels must land on the same screen pixels as direct drawing,
+	// given how draw_image places and rotates the layer
+	int pw, ph;
+	SDL_QueryTexture(img.get(), nullptr, nullptr, &pw, &ph);
+	auto size = img.size();
+	s = std::abs(screen_s);
+	if (screen_s > 0.0f) {
+		ox = screen_ox - std::floor(x * screen_s + screen_ox);
+		oy = screen_oy - std::floor(y * screen_s + screen_oy);
+	} else {
+		ox = std::floor((x + size.first) * screen_s + screen_ox) + pw - screen_ox;
+		oy = std::floor((y + size.second) * screen_s + screen_oy) + ph - screen_oy;
+	}
+	SDL_SetRenderDrawColor(sdlrend, 0, 0, 0, 0);
+	SDL_RenderClear(sdlrend);
+	SDL_SetRenderDrawColor(sdlrend, current_color.R, current_color.G, current_color.B, 255);
+	return true;
+}
+
+void SdlPlatform::end_layer() {
+	if (!in_layer)
+		return;
+	flush_batch();
+	SDL_SetRenderTarget(sdlrend, nullptr);
+	s = screen_s;
+	ox = screen_ox;
+	oy = screen_oy;
+	in_layer = false;
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+namespace {
+	// Decodes the UTF-8 sequence at pos, replacing invalid ones by U+FFFD
+	uint32_t next_codepoint(const std::string_view text, size_t &pos) {
+		unsigned char c = text[pos++];
+		int extra = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : -1;
+		if (extra < 0)
+			return 0xFFFD;
+		uint32_t cp = extra == 0 ? c : c & (0x3F >> extra);
+		for (int i = 0; i < extra; i++) {
+			if (pos >= text.size() || (text[pos] & 0xC0) != 0x80)
+				return 0xFFFD;
+			cp = (cp << 6) | (text[pos++] & 0x3F);
+		}
+		return cp;
+	}
+}
+
+void SdlPlatform::clear_glyph_atlas() {
+	release_texture(glyph_atlas);
+	if (glyph_atlas != nullptr)
+		SDL_DestroyTexture(glyph_atlas);
+	glyph_atlas = nullptr;
+	glyphs.clear();
+	glyph_fonts.clear();
+	atlas_x = 0;
+	atlas_y = 0;
+	atlas_row = 0;
+}
+
+void SdlPlatform::forget_glyph_font(TTF_Font *font) {
+	// The atlas space is reclaimed when the atlas is next cleared
+	auto it = glyphs.lower_bound({font, 0});
+	while (it != glyphs.end() && it->first.first == font)
+		it = glyphs.erase(it);
+	glyph_fonts.erase(font);
+}
+
+const SdlPlatform::Glyph *SdlPlatform::get_glyph(TTF_Font *font, uint32_t cp) {
+	auto it = glyphs.find({font, cp});
+	if (it != glyphs.end())
+		return &it->second;
+	if (glyph_atlas == nullptr) {
+		glyph_atlas = SDL_CreateTexture(sdlrend, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, glyph_atlas_size, glyph_atlas_size);
+		if (glyph_atlas == nullptr)
+			return nullptr;
+		SDL_SetTextureBlendMode(glyph_atlas, SDL_BLENDMODE_BLEND);
+	}
+	int minx, maxx, miny, maxy, advance;
+	if (TTF_GlyphMetrics32(font, cp, &minx, &maxx, &miny, &maxy, &advance) != 0)
+		return nullptr;
+	Glyph glyph = { { 0, 0, 0, 0 }, std::min(minx, 0), advance };
+	SDL_Surface *surf = cp == ' ' ? nullptr : TTF_RenderGlyph32_Blended(font, cp, SDL_Color{ 255, 255, 255, 255 });
+	if (surf != nullptr && surf->format->format != SDL_PIXELFORMAT_ARGB8888) {
+		SDL_Surface *conv = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_ARGB8888, 0);
+		SDL_FreeSurface(surf);
+		surf = conv;
+	}
+	if (surf != nullptr && surf->w <= glyph_atlas_size && surf->h <= glyph_atlas_size) {
+		// Shelf packing, starting over once the atlas is full
+		if (atlas_x + surf->w > glyph_atlas_size) {
+			atlas_x = 0;
+			atlas_y += atlas_row;
+			atlas_row = 0;
+		}
+		if (atlas_y + surf->h > glyph_atlas_size) {
+			flush_batch();
+			glyphs.clear();
+			glyph_fonts.clear();
+			atlas_x = 0;
+			atlas_y = 0;
+			atlas_row = 0;
+		}
+		glyph.rect = { atlas_x, atlas_y, surf->w, surf->h };
+		SDL_UpdateTexture(glyph_atlas, &glyph.rect, surf->pixels, surf->pitch);
+		atlas_x += surf->w;
+		atlas_row = std::max(atlas_row, surf->h);
+	}
+	if (surf != nullptr)
+		SDL_FreeSurface(surf);
+	return &glyphs.insert_or_assign({font, cp}, glyph).first->second;
+}
+#endif
+
+bool SdlPlatform::has_glyph_atlas() const {
+	return SDL_VERSION_ATLEAST(2, 0, 18);
+}
+
+void SdlPlatform::draw_text(const std::string_view text, const Font &base, float x, float y, Color c) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	const SdlFont &font = dynamic_cast<const SdlFont&>(base);
+	TTF_Font *ttf = font.get();
+	// The characters used by numeric fields are rendered together on first use
+	if (glyph_fonts.insert(ttf).second) {
+		for (uint32_t cp = ' '; cp <= '~'; cp++)
+			get_glyph(ttf, cp);
+	}
+	frame_primitives++;
+	// Glyphs are laid out in font pixels, which map to screen pixels, from
+	// the same corner where draw_image would place the whole string
+	float dir = s > 0.0f ? 1.0f : -1.0f;
+	float px = std::floor(x * s + ox);
+	float py = std::floor(y * s + oy);
+	SDL_Color color = { c.R, c.G, c.B, 255 };
+	int pen = 0;
+	uint32_t prev = 0;
+	size_t pos = 0;
+	while (pos < text.size()) {
+		uint32_t cp = next_codepoint(text, pos);
+		if (prev != 0)
+			pen += TTF_GetFontKerningSizeGlyphs32(ttf, prev, cp);
+		prev = cp;
+		const Glyph *g = get_glyph(ttf, cp);
+		if (g == nullptr)
+			continue;
+		if (g->rect.w > 0) {
+			const SDL_Rect &r = g->rect;
+			float x0 = px + dir * (pen + g->offset);
+			float x1 = x0 + dir * r.w;
+			float y1 = py + dir * r.h;
+			float u0 = r.x / (float)glyph_atlas_size;
+			float u1 = (r.x + r.w) / (float)glyph_atlas_size;
+			float v0 = r.y / (float)glyph_atlas_size;
+			float v1 = (r.y + r.h) / (float)glyph_atlas_size;
+			int first = begin_geometry(glyph_atlas);
+			batch_vertices.push_back({ { x0, py }, color, { u0, v0 } });
+			batch_vertices.push_back({ { x1, py }, color, { u1, v0 } });
+			batch_vertices.push_back({ { x1, y1 }, color, { u1, v1 } });
+			batch_vertices.push_back({ { x0, y1 }, color, { u0, v1 } });
+			batch_indices.insert(batch_indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+		}
+		pen += g->advance;
+	}
+#else
+	UiPlatform::draw_text(text, base, x, y, c);
+#endif
+}
+
 SdlPlatform::SdlImage::SdlImage(SDL_Texture *tex, float w, float h, float s) : tex(tex), w(w), h(h), scale(s) {
 
 }
 
 SdlPlatform::SdlImage::~SdlImage() {
+	if (instance)
+		instance->release_texture(tex);
 	SDL_DestroyTexture(tex);
 }
 
@@ -560,11 +1025,21 @@ std::pair<float, float> SdlPlatform::SdlImage::size() const {
 	return std::make_pair(w / scale, h / scale);
 }
 
+size_t SdlPlatform::SdlImage::byte_size() const {
+	// Textures are RGBA with one texel per screen pixel
+	return (size_t)w * (size_t)h * 4;
+}
+
 SdlPlatform::SdlFontWrapper::SdlFontWrapper(TTF_Font *f) : font(f) {
 
 }
 
 SdlPlatform::SdlFontWrapper::~SdlFontWrapper() {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// A font opened later may reuse the same address
+	if (instance)
+		instance->forget_glyph_font(font);
+#endif
 	TTF_CloseFont(font);
 }
 
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <atomic>
 #include <optional>
 #include <functional>
@@ -68,6 +69,66 @@ private:
 	PlatformUtil::FulfillerList<InputEvent> on_input_list;
 	int present_count;
 	bool running;
+	// Layers created before the last scale change or device reset are stale
+	int layer_epoch = 0;
+	bool in_layer = false;
+	float screen_s, screen_ox, screen_oy;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// Arc meshes relative to their centre, in pixels, by radii, angles and scale
+	struct ArcMesh
+	{
+		std::vector<SDL_Vertex> vertices;
+		std::vector<int> indices;
+	};
+	std::map<std::tuple<float, float, float, float, float>, ArcMesh> arc_meshes;
+	const ArcMesh &get_arc_mesh(float rmin, float rmax, float ang0, float ang1);
+#endif
+	// Consecutive primitives that can be drawn together are queued, and issued
+	// as a single call before anything else is drawn or the frame is presented.
+	// Rectangles are batched by colour, geometry by texture.
+	enum class BatchType { None, Rects, Geometry };
+	BatchType batch_type = BatchType::None;
+	Color batch_color;
+	std::vector<SDL_FRect> batch_rects;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	SDL_Texture *batch_texture = nullptr;
+	std::vector<SDL_Vertex> batch_vertices;
+	std::vector<int> batch_indices;
+	// Set once the renderer rejects SDL_RenderGeometry, after which
+	// primitives go back to the gfx_primitives scanline fills
+	bool geometry_failed = false;
+	int begin_geometry(SDL_Texture *tex);
+	void draw_geometry_fallback();
+#endif
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// Glyphs of every font used with draw_text, rendered in white on demand
+	// into a shared atlas and tinted through the vertex colour
+	struct Glyph
+	{
+		SDL_Rect rect;
+		int offset;
+		int advance;
+	};
+	static const int glyph_atlas_size = 1024;
+	SDL_Texture *glyph_atlas = nullptr;
+	int atlas_x = 0;
+	int atlas_y = 0;
+	int atlas_row = 0;
+	std::map<std::pair<TTF_Font*, uint32_t>, Glyph> glyphs;
+	std::set<TTF_Font*> glyph_fonts;
+	const Glyph *get_glyph(TTF_Font *font, uint32_t cp);
+	void clear_glyph_atlas();
+	void forget_glyph_font(TTF_Font *font);
+#endif
+	// Images flush the batch before their texture is destroyed
+	static SdlPlatform *instance;
+	void release_texture(SDL_Texture *tex);
+	void flush_batch();
+	// Primitives requested and renderer calls issued in the current frame
+	int frame_primitives = 0;
+	int frame_draw_calls = 0;
+	bool show_draw_calls = false;
+	void draw_counter_overlay();
 	std::map<std::string, std::string, std::less<>> ini_items;
 	void load_config(const std::vector<std::string>& args);
 	std::string get_config(const std::string_view key);
@@ -94,8 +155,10 @@ public:
 	public:
 		SdlImage(SDL_Texture *tex, float w, float h, float s);
 		SDL_Texture* get() const;
+		int layer_epoch = -1;
 		~SdlImage() override;
 		std::pair<float, float> size() const override;
+		size_t byte_size() const override;
 	};
 
 	class SdlFont final : public Font
@@ -161,6 +224,11 @@ public:
 	std::unique_ptr<Font> load_font(float size, bool bold, const std::string_view lang) override;
 	std::unique_ptr<Image> make_text_image(const std::string_view text, const Font &font, Color c) override;
 	std::unique_ptr<Image> make_wrapped_text_image(const std::string_view text, const Font &font, float width, int align, Color c) override;
+	std::unique_ptr<Image> create_layer(float w, float h) override;
+	bool begin_layer(Image &layer, float x, float y) override;
+	void end_layer() override;
+	bool has_glyph_atlas() const override;
+	void draw_text(const std::string_view text, const Font &font, float x, float y, Color c) override;
 
 	void set_volume(int vol) override;
 	int get_volume() override;